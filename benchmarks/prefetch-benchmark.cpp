@@ -0,0 +1,162 @@
+// Measures cold starts through 'launch' with and without prefetching
+// (LAUNCH_PREFETCH=0). Before each run, the files listed in the prefetch
+// histories of 'launch' are evicted from the page cache.
+//
+// Usage: prefetch-benchmark <path to launch> <iterations> <application> [arguments]
+//
+// Record a history first: launch the application and leave it running for
+// longer than the error window (LAUNCH_ERROR_WINDOW=1 shortens that). Then pass
+// arguments that make it exit by itself once it has started, e.g., a document
+// and a command to quit, since 'launch' waits for the application to exit.
+//
+// posix_fadvise(POSIX_FADV_DONTNEED) can't evict pages that other processes
+// have mapped, e.g., of libc. Run as root with --drop-caches as the first
+// argument to drop the whole page cache before each run instead.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <string>
+#include <vector>
+
+extern char **environ;
+
+static bool dropCaches = false;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static std::string historyDirectory()
+{
+    const char *cache = getenv("XDG_CACHE_HOME");
+    if (cache && *cache)
+        return std::string(cache) + "/launch/prefetch";
+    return std::string(getenv("HOME") ? getenv("HOME") : "") + "/.cache/launch/prefetch";
+}
+
+// Evicts every file named in the first column of the history files
+static int evictHistoryFiles()
+{
+    if (dropCaches) {
+        sync();
+        std::ofstream("/proc/sys/vm/drop_caches") << "3\n";
+        return -1;
+    }
+    const std::string directory = historyDirectory();
+    DIR *dir = opendir(directory.c_str());
+    if (!dir)
+        return 0;
+    int evicted = 0;
+    while (struct dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.')
+            continue;
+        std::ifstream history(directory + "/" + entry->d_name);
+        std::string line;
+        std::getline(history, line); // Header
+        while (std::getline(history, line)) {
+            const std::string path = line.substr(0, line.find('\t'));
+            int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                continue;
+            posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            close(fd);
+            evicted++;
+        }
+    }
+    closedir(dir);
+    return evicted;
+}
+
+// Returns the wall clock time of one run in milliseconds, or a negative value on failure
+static double run(char **argv, bool prefetch)
+{
+    std::vector<std::string> environment;
+    for (char **e = environ; *e; e++) {
+        if (strncmp(*e, "LAUNCH_PREFETCH=", 16) != 0)
+            environment.push_back(*e);
+    }
+    environment.push_back(prefetch ? "LAUNCH_PREFETCH=1" : "LAUNCH_PREFETCH=0");
+    std::vector<char *> envp;
+    for (std::string &entry : environment)
+        envp.push_back(&entry[0]);
+    envp.push_back(nullptr);
+
+    evictHistoryFiles();
+    double start = now();
+    pid_t pid;
+    if (posix_spawn(&pid, argv[0], nullptr, nullptr, argv, envp.data()) != 0)
+        return -1;
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+    return now() - start;
+}
+
+static void report(char **argv, bool prefetch, int iterations)
+{
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        double t = run(argv, prefetch);
+        if (t < 0) {
+            fprintf(stderr, "%s %s failed\n", argv[0], argv[1]);
+            exit(1);
+        }
+        times.push_back(t);
+    }
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double t : times)
+        sum += t;
+    printf("%-20s mean %8.2f ms  median %8.2f ms  min %8.2f ms\n",
+           prefetch ? "with prefetching" : "without prefetching", sum / times.size(),
+           times[times.size() / 2], times.front());
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc > 1 && strcmp(argv[1], "--drop-caches") == 0) {
+        dropCaches = true;
+        argv++;
+        argc--;
+    }
+    if (argc < 4) {
+        fprintf(stderr,
+                "USAGE: %s [--drop-caches] <path to launch> <iterations> <application> [arguments]\n",
+                argv[0]);
+        return 1;
+    }
+    int iterations = atoi(argv[2]);
+    if (iterations < 1)
+        iterations = 1;
+
+    // launch <application> [arguments]
+    std::vector<char *> launchArgv;
+    launchArgv.push_back(argv[1]);
+    for (int i = 3; i < argc; i++)
+        launchArgv.push_back(argv[i]);
+    launchArgv.push_back(nullptr);
+
+    int files = evictHistoryFiles();
+    if (files == 0) {
+        fprintf(stderr, "No prefetch history in %s; launch the application first\n",
+                historyDirectory().c_str());
+        return 1;
+    }
+
+    report(launchArgv.data(), false, iterations);
+    report(launchArgv.data(), true, iterations);
+    return 0;
+}
@@ -0,0 +1,79 @@
+// Measures the end-to-end time of 'launch <application>' against
+// 'launch-client <application>' served by a running 'launch --zygote'.
+//
+// Usage: zygote-benchmark <path to launch> <path to launch-client> [iterations] [application]
+//
+// Start 'launch --zygote' first. The application defaults to 'true', which
+// exits immediately, so that mostly the startup cost of 'launch' is measured.
+
+#include <spawn.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+extern char **environ;
+
+static double now()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+// Returns the wall clock time of one run in milliseconds, or a negative value on failure
+static double run(const char *tool, const char *application)
+{
+    char *argv[] = { const_cast<char *>(tool), const_cast<char *>(application), nullptr };
+    double start = now();
+    pid_t pid;
+    if (posix_spawn(&pid, tool, nullptr, nullptr, argv, environ) != 0)
+        return -1;
+    int status;
+    if (waitpid(pid, &status, 0) != pid || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+        return -1;
+    return now() - start;
+}
+
+static void report(const char *tool, const char *application, int iterations)
+{
+    std::vector<double> times;
+    for (int i = 0; i < iterations; i++) {
+        double t = run(tool, application);
+        if (t < 0) {
+            fprintf(stderr, "%s %s failed\n", tool, application);
+            exit(1);
+        }
+        times.push_back(t);
+    }
+    std::sort(times.begin(), times.end());
+    double sum = 0;
+    for (double t : times)
+        sum += t;
+    printf("%-40s mean %8.2f ms  median %8.2f ms  min %8.2f ms\n", tool, sum / times.size(),
+           times[times.size() / 2], times.front());
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3) {
+        fprintf(stderr, "USAGE: %s <path to launch> <path to launch-client> [iterations] [application]\n",
+                argv[0]);
+        return 1;
+    }
+    int iterations = argc > 3 ? atoi(argv[3]) : 20;
+    const char *application = argc > 4 ? argv[4] : "true";
+    if (iterations < 1)
+        iterations = 1;
+
+    // Warm up the page cache so that both are measured under the same conditions
+    run(argv[1], application);
+    run(argv[2], application);
+
+    report(argv[1], application, iterations);
+    report(argv[2], application, iterations);
+    return 0;
+}
@@ -1,23 +1,20 @@
 #include "ApplicationInfo.h"
-#include <KWindowInfo>
 #include <QDebug>
 #include <QStringList>
 #include <QString>
-#include <QProcess>
 #include <QFile>
 #include <QFileInfo>
 #include <QDir>
 
+#include <errno.h>
+#include <fcntl.h>
 #include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #if defined(__FreeBSD__)
-#  include <sys/socket.h>
+#  include <sys/types.h>
 #  include <sys/sysctl.h>
-#  include <sys/param.h>
-#  include <sys/queue.h>
-#  include <sys/user.h>
-#  include <QDir>
-#  include <fcntl.h>
-#  include <libprocstat.h>
 #endif
 
 ApplicationInfo::ApplicationInfo() { }
@@ -69,103 +66,101 @@ QString ApplicationInfo::applicationNiceNameForPath(const QString &path)
     return applicationNiceName;
 }
 
-// Returns the name of the bundle
-// based on the LAUNCHED_BUNDLE environment variable set by the 'launch' command
-QString ApplicationInfo::bundlePathForPId(unsigned int pid)
+// The value of LAUNCHED_BUNDLE in an environment block of NUL-terminated
+// "NAME=value" entries, found without splitting the block into strings
+static QString findLaunchedBundle(const char *environment, size_t size)
 {
-    QString path;
+    static const char Variable[] = "LAUNCHED_BUNDLE=";
+    const size_t variableLength = sizeof(Variable) - 1;
+    const char *position = environment;
+    const char *end = environment + size;
+    while (position < end) {
+        const char *found = static_cast<const char *>(
+                memmem(position, size_t(end - position), Variable, variableLength));
+        if (found == nullptr)
+            return QString();
+        // Only at the start of an entry, not in the value of another variable
+        if (found == environment || found[-1] == '\0') {
+            const char *value = found + variableLength;
+            const char *valueEnd = static_cast<const char *>(memchr(value, '\0', size_t(end - value)));
+            if (valueEnd == nullptr)
+                valueEnd = end;
+            return QString::fromLocal8Bit(value, int(valueEnd - value));
+        }
+        position = found + 1;
+    }
+    return QString();
+}
 
+// Reads the environment of pid into buffer, which is reused across calls
+static bool readEnvironment(unsigned int pid, QByteArray &buffer, size_t *size)
+{
+    if (buffer.size() < 64 * 1024)
+        buffer.resize(64 * 1024);
 #if defined(__FreeBSD__)
-
-    struct procstat *prstat = procstat_open_sysctl();
-    if (prstat == NULL) {
-        return "";
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_ENV, int(pid) };
+    size_t length = size_t(buffer.size());
+    while (sysctl(mib, 4, buffer.data(), &length, nullptr, 0) != 0) {
+        if (errno != ENOMEM || buffer.size() >= 16 * 1024 * 1024)
+            return false;
+        buffer.resize(buffer.size() * 2);
+        length = size_t(buffer.size());
     }
-    unsigned int cnt;
-    kinfo_proc *procinfo = procstat_getprocs(prstat, KERN_PROC_PID, pid, &cnt);
-    if (procinfo == NULL || cnt != 1) {
-        procstat_close(prstat);
-        return "";
-    }
-    char **envs = procstat_getenvv(prstat, procinfo, 0);
-    if (envs == NULL) {
-        procstat_close(prstat);
-        return "";
-    }
-
-    for (int i = 0; envs[i] != NULL; i++) {
-        const QString &entry = QString::fromLocal8Bit(envs[i]);
-        const int splitPos = entry.indexOf('=');
-
-        if (splitPos != -1) {
-            const QString &name = entry.mid(0, splitPos);
-            const QString &value = entry.mid(splitPos + 1, -1);
-            // qDebug() << "name:" << name;
-            // qDebug() << "value:" << value;
-            if (name == "LAUNCHED_BUNDLE") {
-                path = value;
-                break;
+    *size = length;
+    return true;
+#else
+    char path[32];
+    snprintf(path, sizeof(path), "/proc/%u/environ", pid);
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return false;
+    // One read() for all but unusually large environments
+    size_t length = 0;
+    for (;;) {
+        ssize_t count = read(fd, buffer.data() + length, size_t(buffer.size()) - length);
+        if (count < 0 && errno == EINTR)
+            continue;
+        if (count <= 0) {
+            close(fd);
+            *size = length;
+            return count == 0;
+        }
+        length += size_t(count);
+        if (length == size_t(buffer.size())) {
+            if (buffer.size() >= 16 * 1024 * 1024) {
+                close(fd);
+                *size = length;
+                return true;
             }
+            buffer.resize(buffer.size() * 2);
         }
     }
-
-    procstat_freeenvv(prstat);
-    procstat_close(prstat);
-
-#else
-    // Linux; see Menu for a cross-platform solution?
-    qDebug() << "TODO: Implement getting env";
-    path = "ThisIsOnlyImplementedForFreeBSDSoFar";
 #endif
-
-    // qDebug() << "probono: bundlePathForPId returns:" << path;
-    return path;
 }
 
-QString ApplicationInfo::bundlePathForWId(unsigned long long id)
-{
-    QString path;
-    KWindowInfo info(id, NET::WMPid, NET::WM2TransientFor | NET::WM2WindowClass);
-    return bundlePathForPId(info.pid());
-}
-
-QString ApplicationInfo::pathForWId(unsigned long long id)
+// Returns the name of the bundle
+// based on the LAUNCHED_BUNDLE environment variable set by the 'launch' command
+QString ApplicationInfo::bundlePathForPId(unsigned int pid)
 {
-    QString path;
-    KWindowInfo info(id, NET::WMPid, NET::WM2TransientFor | NET::WM2WindowClass);
-
-    // qDebug() << "probono: info.pid():" << info.pid();
-    // qDebug() << "probono: info.windowClassName():" << info.windowClassName();
-
-    QProcess p;
-    QStringList arguments;
-    if (QFile::exists(QString("/proc/%1/file").arg(info.pid()))) {
-        // FreeBSD
-        arguments = QStringList() << "-f" << QString("/proc/%1/file").arg(info.pid());
-    } else if (QFile::exists(QString("/proc/%1/exe").arg(info.pid()))) {
-        // Linux
-        arguments = QStringList() << "-f" << QString("/proc/%1/exe").arg(info.pid());
-    }
-    p.start("readlink", arguments);
-    p.waitForFinished();
-    QString retStr(p.readAllStandardOutput().trimmed());
-    if (!retStr.isEmpty()) {
-        // qDebug() << "probono:" << p.program() << p.arguments();
-        // qDebug() << "probono: retStr:" << retStr;
-        path = retStr;
-    }
-    // qDebug() << "probono: pathForWId returns:" << path;
-    return path;
+    thread_local QByteArray buffer;
+    size_t size = 0;
+    if (pid == 0 || !readEnvironment(pid, buffer, &size))
+        return QString();
+    return findLaunchedBundle(buffer.constData(), size);
 }
 
-QString ApplicationInfo::applicationNiceNameForWId(unsigned long long id)
+QHash<unsigned int, QString> ApplicationInfo::bundlePathsForPIds(const QList<unsigned int> &pids)
 {
-    QString path;
-    QString applicationNiceName;
-    KWindowInfo info(id, NET::WMPid, NET::WM2TransientFor | NET::WM2WindowClass);
-    applicationNiceName = applicationNiceNameForPath(bundlePathForPId(info.pid()));
-    if (applicationNiceName.isEmpty()) {
-        applicationNiceName = QFileInfo(pathForWId(id)).fileName();
+    QHash<unsigned int, QString> paths;
+    QByteArray buffer;
+    for (unsigned int pid : pids) {
+        if (paths.contains(pid))
+            continue;
+        size_t size = 0;
+        if (pid != 0 && readEnvironment(pid, buffer, &size))
+            paths.insert(pid, findLaunchedBundle(buffer.constData(), size));
+        else
+            paths.insert(pid, QString());
     }
-    return applicationNiceName;
+    return paths;
 }
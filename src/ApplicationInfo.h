@@ -1,6 +1,8 @@
 #ifndef APPLICATIONINFO_H
 #define APPLICATIONINFO_H
 
+#include <QHash>
+#include <QList>
 #include <QString>
 
 /*
@@ -8,6 +10,7 @@
  * Currently being used in:
  * Menu (master)
  * launch (copy)
+ * Other components should link against liblaunchindex (LaunchIndex.h) instead of copying it
  */
 
 class ApplicationInfo
@@ -60,35 +63,14 @@ public:
     static QString bundlePathForPId(unsigned int pid);
 
     /**
-     * Get the bundle path for a given window ID.
+     * Get the bundle paths for many process IDs at once.
      *
-     * This function returns the bundle path associated with a window ID.
+     * Like bundlePathForPId(), but reads all environments into the same buffer.
      *
-     * @param id The window ID.
-     * @return The bundle path.
-     */
-    static QString bundlePathForWId(unsigned long long id);
-
-    /**
-     * Get the path for a given window ID.
-     *
-     * This function returns the path associated with a window ID.
-     *
-     * @param id The window ID.
-     * @return The path.
-     */
-    static QString pathForWId(unsigned long long id);
-
-    /**
-     * Get a human-readable application name for a given window ID.
-     *
-     * This function returns a nice name for the application associated with
-     * a window ID.
-     *
-     * @param id The window ID.
-     * @return The application nice name.
+     * @param pids The process IDs; duplicates are looked up once.
+     * @return The bundle path for each process ID, empty if there is none.
      */
-    static QString applicationNiceNameForWId(unsigned long long id);
+    static QHash<unsigned int, QString> bundlePathsForPIds(const QList<unsigned int> &pids);
 };
 
 #endif // APPLICATIONINFO_H
@@ -6,7 +6,8 @@
 #include <QDir>
 #include <QMessageBox>
 #include <QPushButton>
-#include "launcher.h"
+#include <QFileInfo>
+#include "Platform.h"
 #include "DbManager.h"
 #include <QFileDialog>
 
@@ -55,9 +56,6 @@ ApplicationSelectionDialog::ApplicationSelectionDialog(QString *fileOrProtocol,
         QStringList selectedFiles = fileDialog.selectedFiles();
         if (selectedFiles.size() == 1) {
             QString selectedFile = selectedFiles.at(0);
-            QStringList args;
-            args << QFileInfo(selectedFile).absoluteFilePath();
-            args << *fileOrProtocol;
 
             // Symlink the chosen application to the launch "database"
             // so that it can be set as the default application later on
@@ -82,9 +80,15 @@ ApplicationSelectionDialog::ApplicationSelectionDialog(QString *fileOrProtocol,
                 QMessageBox::critical(this, tr("Error"), tr("Could not create symlink from %1 to %2").arg(symlinkPath).arg(mimeSymlinkPath));
             }
 
-            this->hide();
-            Launcher launcher;
-            launcher.launch(args);
+            // Select the chosen application so that whoever shows this dialog
+            // launches it like any other application from the list
+            QListWidgetItem *item = new QListWidgetItem(QFileInfo(selectedFile).completeBaseName());
+            item->setData(Qt::UserRole, QDir(selectedFile).canonicalPath());
+            item->setToolTip(QDir(selectedFile).canonicalPath());
+            ui->listWidget->addItem(item);
+            ui->listWidget->setCurrentItem(item);
+            item->setSelected(true);
+            this->accept();
         }
     }
         
@@ -360,10 +364,8 @@ QString ApplicationSelectionDialog::getSelectedApplication()
     // Touch the file and its parent directory so that Filer updates its icon
     QFileInfo fileInfo(*fileOrProtocol);
     if (fileInfo.exists()) {
-    QProcess process;
         qDebug() << "Touching parent directory: " << fileInfo.dir().path();
-        process.start("touch", QStringList() << fileInfo.dir().path());
-        process.waitForFinished();
+        Platform::touch(fileInfo.dir().path());
     }
 
     return ui->listWidget->selectedItems().first()->text();
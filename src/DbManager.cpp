@@ -3,7 +3,7 @@
 #include <QDir>
 #include <QDirIterator>
 #include <QStandardPaths>
-#include <QMessageBox>
+#include "GuiHelper.h"
 #include "extattrs.h"
 
 
@@ -292,10 +292,7 @@ bool DbManager::_removeApplication(const QString &path)
                 success = true;
             } else {
                 qDebug() << "Failed to remove symlink:" << symlinkPath;
-                QMessageBox msgBox;
-                msgBox.setIcon(QMessageBox::Critical);
-                msgBox.setText("Failed to remove symlink:" + symlinkPath);
-                msgBox.exec();
+                GuiHelper::warning(" ", "Failed to remove symlink:" + symlinkPath);
             }
         }
     }
@@ -319,10 +316,7 @@ bool DbManager::_removeApplication(const QString &path)
                         success = true;
                     } else {
                         qDebug() << "Failed to remove symlink:" << symlinkPath;
-                        QMessageBox msgBox;
-                        msgBox.setIcon(QMessageBox::Critical);
-                        msgBox.setText("Failed to remove symlink:" + symlinkPath);
-                        msgBox.exec();
+                        GuiHelper::warning(" ", "Failed to remove symlink:" + symlinkPath);
                     }
                 }
             }
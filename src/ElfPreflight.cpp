@@ -0,0 +1,626 @@
+#include "ElfPreflight.h"
+
+#include <QByteArray>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QStandardPaths>
+
+#include <elf.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+// Only executables of our own word size, byte order and machine are checked
+#if UINTPTR_MAX > 0xffffffffu
+typedef Elf64_Ehdr Ehdr;
+typedef Elf64_Phdr Phdr;
+typedef Elf64_Dyn Dyn;
+typedef Elf64_Verneed Verneed;
+typedef Elf64_Vernaux Vernaux;
+typedef Elf64_Verdef Verdef;
+typedef Elf64_Verdaux Verdaux;
+static const unsigned char NativeClass = ELFCLASS64;
+#else
+typedef Elf32_Ehdr Ehdr;
+typedef Elf32_Phdr Phdr;
+typedef Elf32_Dyn Dyn;
+typedef Elf32_Verneed Verneed;
+typedef Elf32_Vernaux Vernaux;
+typedef Elf32_Verdef Verdef;
+typedef Elf32_Verdaux Verdaux;
+static const unsigned char NativeClass = ELFCLASS32;
+#endif
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const unsigned char NativeData = ELFDATA2LSB;
+#else
+static const unsigned char NativeData = ELFDATA2MSB;
+#endif
+
+#if defined(__x86_64__)
+static const int NativeMachine = EM_X86_64;
+#elif defined(__aarch64__)
+static const int NativeMachine = EM_AARCH64;
+#elif defined(__i386__)
+static const int NativeMachine = EM_386;
+#elif defined(__arm__)
+static const int NativeMachine = EM_ARM;
+#elif defined(__powerpc64__)
+static const int NativeMachine = EM_PPC64;
+#elif defined(__riscv)
+static const int NativeMachine = EM_RISCV;
+#else
+static const int NativeMachine = -1; // Unknown; nothing is checked
+#endif
+
+// The Debian multiarch directories, which glibc built for such distributions
+// searches before the others
+#if defined(__x86_64__)
+static const char MultiarchTriplet[] = "x86_64-linux-gnu";
+#elif defined(__aarch64__)
+static const char MultiarchTriplet[] = "aarch64-linux-gnu";
+#elif defined(__i386__)
+static const char MultiarchTriplet[] = "i386-linux-gnu";
+#elif defined(__arm__) && defined(__ARM_PCS_VFP)
+static const char MultiarchTriplet[] = "arm-linux-gnueabihf";
+#elif defined(__arm__)
+static const char MultiarchTriplet[] = "arm-linux-gnueabi";
+#elif defined(__powerpc64__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+static const char MultiarchTriplet[] = "powerpc64le-linux-gnu";
+#elif defined(__powerpc64__)
+static const char MultiarchTriplet[] = "powerpc64-linux-gnu";
+#elif defined(__riscv)
+static const char MultiarchTriplet[] = "riscv64-linux-gnu";
+#else
+static const char MultiarchTriplet[] = "";
+#endif
+
+// Give up rather than walk pathological dependency trees
+static const size_t MaxObjects = 1024;
+
+// An executable or shared library, mapped and parsed
+struct ElfObject
+{
+    std::string path;
+    std::string interpreter;
+    std::vector<std::string> needed;
+    std::vector<std::string> rpath;
+    std::vector<std::string> runpath;
+    bool hasRunpath = false;
+    // Contains something like $LIB, so missing libraries can't be told for sure
+    bool uncertain = false;
+    // Library file name -> versions needed from it, and whether each is weak
+    std::map<std::string, std::vector<std::pair<std::string, bool>>> versionsNeeded;
+    std::set<std::string> versionsDefined;
+};
+
+class MappedFile
+{
+public:
+    ~MappedFile()
+    {
+        if (data)
+            munmap(const_cast<char *>(data), size);
+    }
+
+    bool map(const std::string &path)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0) {
+            close(fd);
+            return false;
+        }
+        void *p = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED)
+            return false;
+        data = static_cast<const char *>(p);
+        size = size_t(st.st_size);
+        return true;
+    }
+
+    // Whether length bytes at offset are within the file
+    bool contains(uint64_t offset, uint64_t length) const
+    {
+        return offset <= size && length <= size - offset;
+    }
+
+    const char *data = nullptr;
+    size_t size = 0;
+};
+
+static std::string directoryOf(const std::string &path)
+{
+    size_t slash = path.rfind('/');
+    return slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+}
+
+// Split a colon separated list of directories, expanding $ORIGIN
+static std::vector<std::string> splitSearchPath(const std::string &list, const std::string &origin,
+                                                bool *uncertain)
+{
+    std::vector<std::string> result;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t end = list.find(':', start);
+        if (end == std::string::npos)
+            end = list.size();
+        std::string directory = list.substr(start, end - start);
+        for (const char *token : { "${ORIGIN}", "$ORIGIN" }) {
+            size_t pos;
+            while ((pos = directory.find(token)) != std::string::npos)
+                directory.replace(pos, strlen(token), origin);
+        }
+        if (directory.find('$') != std::string::npos)
+            *uncertain = true;
+        else if (!directory.empty())
+            result.push_back(directory);
+        start = end + 1;
+    }
+    return result;
+}
+
+// Parse the ELF file at path; returns nullptr if it is not an ELF file for our machine
+static std::unique_ptr<ElfObject> parseElf(const std::string &path)
+{
+    MappedFile file;
+    if (!file.map(path) || !file.contains(0, sizeof(Ehdr)))
+        return nullptr;
+    const Ehdr *ehdr = reinterpret_cast<const Ehdr *>(file.data);
+    if (memcmp(ehdr->e_ident, ELFMAG, SELFMAG) != 0 || ehdr->e_ident[EI_CLASS] != NativeClass
+        || ehdr->e_ident[EI_DATA] != NativeData || ehdr->e_machine != NativeMachine
+        || ehdr->e_phentsize != sizeof(Phdr)
+        || !file.contains(ehdr->e_phoff, uint64_t(ehdr->e_phnum) * sizeof(Phdr)))
+        return nullptr;
+
+    std::unique_ptr<ElfObject> object(new ElfObject);
+    char resolved[PATH_MAX];
+    object->path = realpath(path.c_str(), resolved) ? resolved : path;
+
+    const Phdr *phdrs = reinterpret_cast<const Phdr *>(file.data + ehdr->e_phoff);
+    const Phdr *dynamic = nullptr;
+    for (int i = 0; i < ehdr->e_phnum; i++) {
+        if (phdrs[i].p_type == PT_INTERP && file.contains(phdrs[i].p_offset, phdrs[i].p_filesz))
+            object->interpreter = std::string(file.data + phdrs[i].p_offset,
+                                              strnlen(file.data + phdrs[i].p_offset,
+                                                      phdrs[i].p_filesz));
+        else if (phdrs[i].p_type == PT_DYNAMIC
+                 && file.contains(phdrs[i].p_offset, phdrs[i].p_filesz))
+            dynamic = &phdrs[i];
+    }
+    if (dynamic == nullptr)
+        return object; // Static
+
+    // Addresses in the dynamic section are virtual; find them in the file
+    auto fileOffset = [&](uint64_t address, uint64_t *offset) {
+        for (int i = 0; i < ehdr->e_phnum; i++) {
+            if (phdrs[i].p_type == PT_LOAD && address >= phdrs[i].p_vaddr
+                && address - phdrs[i].p_vaddr < phdrs[i].p_filesz) {
+                *offset = phdrs[i].p_offset + (address - phdrs[i].p_vaddr);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    const Dyn *dyn = reinterpret_cast<const Dyn *>(file.data + dynamic->p_offset);
+    const size_t dynCount = dynamic->p_filesz / sizeof(Dyn);
+    uint64_t strtab = 0, strsz = 0, verneed = 0, verneedNum = 0, verdef = 0, verdefNum = 0;
+    std::vector<uint64_t> neededOffsets;
+    uint64_t rpathOffset = UINT64_MAX, runpathOffset = UINT64_MAX;
+    for (size_t i = 0; i < dynCount && dyn[i].d_tag != DT_NULL; i++) {
+        switch (dyn[i].d_tag) {
+        case DT_STRTAB: strtab = dyn[i].d_un.d_ptr; break;
+        case DT_STRSZ: strsz = dyn[i].d_un.d_val; break;
+        case DT_NEEDED: neededOffsets.push_back(dyn[i].d_un.d_val); break;
+        case DT_RPATH: rpathOffset = dyn[i].d_un.d_val; break;
+        case DT_RUNPATH: runpathOffset = dyn[i].d_un.d_val; break;
+        case DT_VERNEED: verneed = dyn[i].d_un.d_ptr; break;
+        case DT_VERNEEDNUM: verneedNum = dyn[i].d_un.d_val; break;
+        case DT_VERDEF: verdef = dyn[i].d_un.d_ptr; break;
+        case DT_VERDEFNUM: verdefNum = dyn[i].d_un.d_val; break;
+        default: break;
+        }
+    }
+
+    uint64_t strtabOffset;
+    if (!fileOffset(strtab, &strtabOffset) || !file.contains(strtabOffset, strsz)) {
+        object->uncertain = true;
+        return object;
+    }
+    auto string = [&](uint64_t offset) {
+        if (offset >= strsz)
+            return std::string();
+        const char *s = file.data + strtabOffset + offset;
+        return std::string(s, strnlen(s, strsz - offset));
+    };
+
+    for (uint64_t offset : neededOffsets)
+        object->needed.push_back(string(offset));
+    const std::string origin = directoryOf(object->path);
+    if (runpathOffset != UINT64_MAX) {
+        object->hasRunpath = true;
+        object->runpath = splitSearchPath(string(runpathOffset), origin, &object->uncertain);
+    } else if (rpathOffset != UINT64_MAX) {
+        object->rpath = splitSearchPath(string(rpathOffset), origin, &object->uncertain);
+    }
+
+    uint64_t offset;
+    if (verneed && fileOffset(verneed, &offset)) {
+        for (uint64_t i = 0; i < verneedNum && file.contains(offset, sizeof(Verneed)); i++) {
+            const Verneed *need = reinterpret_cast<const Verneed *>(file.data + offset);
+            std::vector<std::pair<std::string, bool>> &versions =
+                    object->versionsNeeded[string(need->vn_file)];
+            uint64_t auxOffset = offset + need->vn_aux;
+            for (int j = 0; j < need->vn_cnt && file.contains(auxOffset, sizeof(Vernaux)); j++) {
+                const Vernaux *aux = reinterpret_cast<const Vernaux *>(file.data + auxOffset);
+                versions.emplace_back(string(aux->vna_name), (aux->vna_flags & VER_FLG_WEAK) != 0);
+                if (aux->vna_next == 0)
+                    break;
+                auxOffset += aux->vna_next;
+            }
+            if (need->vn_next == 0)
+                break;
+            offset += need->vn_next;
+        }
+    }
+    if (verdef && fileOffset(verdef, &offset)) {
+        for (uint64_t i = 0; i < verdefNum && file.contains(offset, sizeof(Verdef)); i++) {
+            const Verdef *def = reinterpret_cast<const Verdef *>(file.data + offset);
+            if (def->vd_cnt > 0 && file.contains(offset + def->vd_aux, sizeof(Verdaux))) {
+                const Verdaux *aux =
+                        reinterpret_cast<const Verdaux *>(file.data + offset + def->vd_aux);
+                object->versionsDefined.insert(string(aux->vda_name));
+            }
+            if (def->vd_next == 0)
+                break;
+            offset += def->vd_next;
+        }
+    }
+    return object;
+}
+
+// glibc's /etc/ld.so.cache in the "glibc-ld.so.cache1.1" format, possibly after
+// an old "ld.so-1.7.0" one: library file name -> paths
+static void readLdSoCache(std::multimap<std::string, std::string> &libraries)
+{
+    MappedFile file;
+    if (!file.map("/etc/ld.so.cache"))
+        return;
+
+    uint64_t start = 0;
+    static const char OldMagic[] = "ld.so-1.7.0";
+    if (file.contains(0, sizeof(OldMagic) + 4) && memcmp(file.data, OldMagic, sizeof(OldMagic)) == 0) {
+        uint32_t oldCount;
+        memcpy(&oldCount, file.data + sizeof(OldMagic), 4);
+        start = sizeof(OldMagic) + 4 + uint64_t(oldCount) * 12;
+        start = (start + alignof(uint64_t) - 1) & ~uint64_t(alignof(uint64_t) - 1);
+    }
+
+    static const char NewMagic[] = "glibc-ld.so.cache1.1";
+    const uint64_t headerSize = 48, entrySize = 24;
+    if (!file.contains(start, headerSize)
+        || memcmp(file.data + start, NewMagic, sizeof(NewMagic) - 1) != 0)
+        return;
+    uint32_t count;
+    memcpy(&count, file.data + start + 20, 4);
+    if (!file.contains(start + headerSize, uint64_t(count) * entrySize))
+        return;
+
+    // String offsets are relative to the new header
+    auto string = [&](uint32_t offset) {
+        if (!file.contains(start + offset, 1))
+            return std::string();
+        const char *s = file.data + start + offset;
+        return std::string(s, strnlen(s, file.size - start - offset));
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        const char *entry = file.data + start + headerSize + i * entrySize;
+        uint32_t key, value;
+        memcpy(&key, entry + 4, 4);
+        memcpy(&value, entry + 8, 4);
+        libraries.emplace(string(key), string(value));
+    }
+}
+
+// FreeBSD's /var/run/ld-elf.so.hints holds the directories given to ldconfig
+static std::vector<std::string> readElfHints()
+{
+    MappedFile file;
+    uint32_t header[6];
+    if (!file.map("/var/run/ld-elf.so.hints") || !file.contains(0, sizeof(header)))
+        return {};
+    memcpy(header, file.data, sizeof(header));
+    const uint32_t magic = 0x746e6845, strtab = header[2], dirlist = header[4],
+                   dirlistlen = header[5];
+    if (header[0] != magic || !file.contains(uint64_t(strtab) + dirlist, dirlistlen))
+        return {};
+    bool uncertain = false;
+    return splitSearchPath(std::string(file.data + strtab + dirlist, dirlistlen), "", &uncertain);
+}
+
+// musl reads the directories from /etc/ld-musl-<arch>.path
+static std::vector<std::string> readMuslPath(const std::string &interpreter)
+{
+    std::string name = interpreter.substr(interpreter.rfind('/') + 1);
+    size_t so = name.find(".so");
+    std::string pathFile = "/etc/" + name.substr(0, so) + ".path";
+    QFile file(QString::fromStdString(pathFile));
+    if (!file.open(QIODevice::ReadOnly))
+        return { "/lib", "/usr/local/lib", "/usr/lib" };
+    std::string list = file.readAll().replace('\n', ':').toStdString();
+    bool uncertain = false;
+    return splitSearchPath(list, "", &uncertain);
+}
+
+static bool isCompatible(const std::string &path, std::map<std::string, std::unique_ptr<ElfObject>> &parsed)
+{
+    auto it = parsed.find(path);
+    if (it != parsed.end())
+        return it->second != nullptr;
+    std::unique_ptr<ElfObject> object = parseElf(path);
+    bool compatible = object != nullptr;
+    parsed[path] = std::move(object);
+    return compatible;
+}
+
+// Where the files of known good executables are remembered
+static QString goodExecutablesPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/launch/elf-preflight";
+}
+
+// And those of executables that have failed, with what is missing
+static QString failedExecutablesPath()
+{
+    return goodExecutablesPath() + "-failed";
+}
+
+static QByteArray fileStamp(const struct stat &st)
+{
+    return QByteArray::number(qulonglong(st.st_dev)) + ' ' + QByteArray::number(qulonglong(st.st_ino))
+            + ' ' + QByteArray::number(qlonglong(st.st_mtim.tv_sec)) + '.'
+            + QByteArray::number(qlonglong(st.st_mtim.tv_nsec));
+}
+
+// "<device> <inode> <mtime>", or zeros if there is no such file, so that it
+// appearing changes the stamp too
+static QByteArray pathStamp(const char *path)
+{
+    struct stat st;
+    if (stat(path, &st) != 0)
+        return "0 0 0.0";
+    return fileStamp(st);
+}
+
+// An entry is a line of the stamp and the LD_LIBRARY_PATH of the executable,
+// then resultFields fields with the result, followed by "<TAB><stamp> <path>"
+// per file or directory the result depends on. Returns the result fields of the
+// entry for key if none of these has changed since
+static bool findEntry(const QString &cachePath, const QByteArray &key, int resultFields,
+                      QList<QByteArray> *result)
+{
+    QFile cache(cachePath);
+    if (!cache.open(QIODevice::ReadOnly))
+        return false;
+    const QByteArray entries = '\n' + cache.readAll();
+    int start = entries.lastIndexOf('\n' + key + '\t');
+    if (start < 0)
+        return false;
+    int end = entries.indexOf('\n', start + 1);
+    QList<QByteArray> fields =
+            entries.mid(start + key.size() + 2, end < 0 ? -1 : end - start - key.size() - 2)
+                    .split('\t');
+    if (fields.size() < resultFields)
+        return false;
+    if (result)
+        *result = fields.mid(0, resultFields);
+    for (int i = resultFields; i < fields.size(); i++) {
+        const QByteArray &file = fields.at(i);
+        int pathStart = file.indexOf(' ', file.indexOf(' ', file.indexOf(' ') + 1) + 1);
+        if (pathStart < 0 || pathStamp(file.mid(pathStart + 1).constData()) != file.left(pathStart))
+            return false;
+    }
+    return true;
+}
+
+// Start over once the file grows large
+static void addEntry(const QString &cachePath, const QByteArray &entry)
+{
+    QDir().mkpath(QFileInfo(cachePath).path());
+    QFile cache(cachePath);
+    QIODevice::OpenMode mode = QIODevice::WriteOnly
+            | (QFileInfo(cachePath).size() > 1024 * 1024 ? QIODevice::Truncate
+                                                         : QIODevice::Append);
+    if (cache.open(mode))
+        cache.write(entry + '\n');
+}
+
+static void appendStamps(QByteArray &entry, const std::set<std::string> &paths)
+{
+    for (const std::string &path : paths)
+        entry += '\t' + pathStamp(path.c_str()) + ' ' + QByteArray(path.c_str());
+}
+
+ElfPreflight::Result ElfPreflight::check(const QString &executable, const QString &libraryPath)
+{
+    Result result;
+    const std::string path = QFile::encodeName(executable).toStdString();
+    struct stat st;
+    if (NativeMachine < 0 || stat(path.c_str(), &st) != 0)
+        return result;
+
+    const QByteArray key = fileStamp(st) + ' ' + QByteArray::number(qHash(libraryPath), 16);
+    if (findEntry(goodExecutablesPath(), key, 0, nullptr))
+        return result;
+    // A broken executable is not walked again until something it was looked up in changes
+    QList<QByteArray> failed;
+    if (findEntry(failedExecutablesPath(), key, 4, &failed)) {
+        result.problem = ProblemKind(failed[0].toInt());
+        result.library = QFile::decodeName(failed[1]);
+        result.version = QString::fromUtf8(failed[2]);
+        result.requiredBy = QFile::decodeName(failed[3]);
+        return result;
+    }
+
+    std::map<std::string, std::unique_ptr<ElfObject>> parsed;
+    std::unique_ptr<ElfObject> root = parseElf(path);
+    if (!root || root->needed.empty())
+        return result; // Not for us to check, or static
+
+    const ElfObject *exe = root.get();
+#if defined(__FreeBSD__)
+    // Linux executables are run by the compatibility layer, with their
+    // libraries below /compat/linux
+    if (exe->interpreter.find("ld-elf") == std::string::npos)
+        return result;
+#endif
+    if (!exe->interpreter.empty() && access(exe->interpreter.c_str(), X_OK) != 0) {
+        result.problem = MissingInterpreter;
+        result.library = QFile::decodeName(exe->interpreter.c_str());
+        result.requiredBy = executable;
+        return result;
+    }
+
+    // The directories of the system, depending on the loader
+    std::multimap<std::string, std::string> cache;
+    std::vector<std::string> systemDirectories;
+    const std::string &interpreter = exe->interpreter;
+    if (interpreter.find("ld-elf") != std::string::npos) {
+        systemDirectories = readElfHints();
+        systemDirectories.insert(systemDirectories.end(), { "/lib", "/usr/lib" });
+    } else if (interpreter.find("ld-musl") != std::string::npos) {
+        systemDirectories = readMuslPath(interpreter);
+    } else {
+        readLdSoCache(cache);
+        if (MultiarchTriplet[0] != '\0') {
+            systemDirectories = { std::string("/lib/") + MultiarchTriplet,
+                                  std::string("/usr/lib/") + MultiarchTriplet };
+        }
+        systemDirectories.insert(systemDirectories.end(),
+                                 { "/lib64", "/usr/lib64", "/lib", "/usr/lib" });
+    }
+    bool libraryPathUncertain = false;
+    const std::vector<std::string> libraryDirectories = splitSearchPath(
+            QFile::encodeName(libraryPath).toStdString(), "", &libraryPathUncertain);
+
+    auto resolve = [&](const std::string &name, const ElfObject &object) -> std::string {
+        if (name.find('/') != std::string::npos)
+            return isCompatible(name, parsed) ? name : std::string();
+        std::vector<const std::vector<std::string> *> searchPath;
+        if (!object.hasRunpath) {
+            searchPath.push_back(&object.rpath);
+            if (&object != exe && !exe->hasRunpath)
+                searchPath.push_back(&exe->rpath);
+        }
+        searchPath.push_back(&libraryDirectories);
+        searchPath.push_back(&object.runpath);
+        for (const std::vector<std::string> *directories : searchPath) {
+            for (const std::string &directory : *directories) {
+                const std::string candidate = directory + "/" + name;
+                if (access(candidate.c_str(), F_OK) == 0 && isCompatible(candidate, parsed))
+                    return candidate;
+            }
+        }
+        auto range = cache.equal_range(name);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (isCompatible(it->second, parsed))
+                return it->second;
+        }
+        for (const std::string &directory : systemDirectories) {
+            const std::string candidate = directory + "/" + name;
+            if (access(candidate.c_str(), F_OK) == 0 && isCompatible(candidate, parsed))
+                return candidate;
+        }
+        return std::string();
+    };
+
+    // Breadth first, like the loader; each library is loaded once by its name
+    std::map<std::string, const ElfObject *> loaded;
+    std::vector<const ElfObject *> objects = { exe };
+
+    // The result stays the same until one of the objects or a place the missing
+    // library could appear in changes
+    auto rememberFailure = [&]() {
+        std::set<std::string> paths(systemDirectories.begin(), systemDirectories.end());
+        paths.insert(libraryDirectories.begin(), libraryDirectories.end());
+        paths.insert({ "/etc/ld.so.cache", "/var/run/ld-elf.so.hints" });
+        for (const ElfObject *object : objects) {
+            paths.insert(object->path);
+            paths.insert(object->rpath.begin(), object->rpath.end());
+            paths.insert(object->runpath.begin(), object->runpath.end());
+        }
+        QByteArray entry = key + '\t' + QByteArray::number(int(result.problem)) + '\t'
+                + QFile::encodeName(result.library) + '\t' + result.version.toUtf8() + '\t'
+                + QFile::encodeName(result.requiredBy);
+        appendStamps(entry, paths);
+        addEntry(failedExecutablesPath(), entry);
+    };
+    for (size_t i = 0; i < objects.size(); i++) {
+        if (objects.size() > MaxObjects)
+            return Result();
+        const ElfObject &object = *objects[i];
+        for (const std::string &name : object.needed) {
+            if (loaded.count(name))
+                continue;
+            const std::string found = resolve(name, object);
+            if (found.empty()) {
+                if (object.uncertain || libraryPathUncertain)
+                    continue;
+                result.problem = MissingLibrary;
+                result.library = QFile::decodeName(name.c_str());
+                result.requiredBy = QFile::decodeName(object.path.c_str());
+                rememberFailure();
+                return result;
+            }
+            const ElfObject *library = parsed[found].get();
+            loaded[name] = library;
+            objects.push_back(library);
+        }
+    }
+
+    for (const ElfObject *object : objects) {
+        for (const auto &need : object->versionsNeeded) {
+            auto it = loaded.find(need.first);
+            if (it == loaded.end())
+                continue; // E.g., the loader itself
+            const ElfObject *library = it->second;
+            for (const auto &version : need.second) {
+                if (version.second || library->versionsDefined.count(version.first))
+                    continue;
+                result.problem = MissingVersion;
+                result.library = QFile::decodeName(library->path.c_str());
+                result.version = QString::fromStdString(version.first);
+                result.requiredBy = QFile::decodeName(object->path.c_str());
+                rememberFailure();
+                return result;
+            }
+        }
+    }
+
+    // Remember that this executable is fine
+    QByteArray entry = key;
+    std::set<std::string> paths;
+    for (const auto &library : loaded)
+        paths.insert(library.second->path);
+    appendStamps(entry, paths);
+    addEntry(goodExecutablesPath(), entry);
+    return result;
+}
@@ -0,0 +1,50 @@
+#ifndef ELFPREFLIGHT_H
+#define ELFPREFLIGHT_H
+
+#include <QString>
+
+/**
+ * @file ElfPreflight.h
+ * @class ElfPreflight
+ * @brief Finds missing shared libraries of an ELF executable without running it.
+ *
+ * Reads PT_INTERP, DT_NEEDED, DT_RPATH/DT_RUNPATH and the version needs of the
+ * executable and of all libraries it depends on. Libraries are looked up the way
+ * the dynamic loader does: in the rpath, LD_LIBRARY_PATH, the runpath,
+ * ld.so.cache (glibc) or ld-elf.so.hints (FreeBSD), and the default directories.
+ * Only executables for the same machine as 'launch' are checked. If anything
+ * cannot be resolved with certainty, such as $LIB in a runpath, the executable
+ * is assumed to be fine and left to the loader.
+ *
+ * Executables that have passed are remembered by device, inode and modification
+ * time in ~/.cache/launch/elf-preflight, so they are not checked again. Those
+ * that have failed are remembered with the result in elf-preflight-failed,
+ * until the executable, one of its libraries or one of the directories a
+ * missing library was looked up in changes.
+ */
+class ElfPreflight
+{
+public:
+    enum ProblemKind {
+        NoProblem,
+        MissingInterpreter, /**< The dynamic loader itself is missing. */
+        MissingLibrary, /**< A DT_NEEDED library is not found. */
+        MissingVersion /**< A library is found, but lacks a symbol version. */
+    };
+
+    struct Result
+    {
+        ProblemKind problem = NoProblem;
+        QString library; /**< The missing library or interpreter, or the library lacking the version. */
+        QString version; /**< The missing version. */
+        QString requiredBy; /**< The executable or library that needs it. */
+    };
+
+    /**
+     * @param executable Path of the executable; anything but ELF passes.
+     * @param libraryPath The LD_LIBRARY_PATH the executable will run with.
+     */
+    static Result check(const QString &executable, const QString &libraryPath);
+};
+
+#endif // ELFPREFLIGHT_H
@@ -0,0 +1,231 @@
+#include "ErrorLog.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QRegularExpression>
+
+#include <algorithm>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Logs of older processes of the same application that are kept
+static const int MaxLogsPerApplication = 10;
+
+// Bytes moved per system call
+static const size_t ChunkSize = 64 * 1024;
+
+// How long to wait for room in the forward fd before giving up on it, so
+// that nobody reading it can't hold up the supervisor
+static const int ForwardTimeoutMsecs = 200;
+
+ErrorLog::ErrorLog()
+    : m_fd(-1), m_forwardFd(-1), m_forwardIsPipe(false), m_canSplice(true), m_teed(0), m_size(0), m_maxSize(0)
+{
+}
+
+ErrorLog::~ErrorLog()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+QString ErrorLog::directory()
+{
+    QString stateHome = qEnvironmentVariable("XDG_STATE_HOME");
+    if (stateHome.isEmpty())
+        stateHome = QDir::homePath() + "/.local/state";
+    return stateHome + "/launch/logs";
+}
+
+bool ErrorLog::open(const QString &name, pid_t pid, qint64 maxSize)
+{
+    QString baseName = name;
+    baseName.replace('/', '_');
+    QDir dir(directory());
+    if (!dir.mkpath(".")) {
+        qDebug() << "# Cannot create" << dir.path();
+        return false;
+    }
+
+    // Newest first; make room for the new one. The glob also matches the logs
+    // of, e.g., "Foo-Bar" for "Foo", so only <name>-<pid>.log are counted
+    const QRegularExpression ownLog(
+            QString("^%1-\\d+\\.log$").arg(QRegularExpression::escape(baseName)));
+    QFileInfoList logs;
+    for (const QFileInfo &log :
+         dir.entryInfoList({ baseName + "-*.log" }, QDir::Files, QDir::Time)) {
+        if (ownLog.match(log.fileName()).hasMatch())
+            logs.append(log);
+    }
+    for (int i = MaxLogsPerApplication - 1; i < logs.size(); i++) {
+        QFile::remove(logs.at(i).absoluteFilePath());
+        QFile::remove(logs.at(i).absoluteFilePath() + ".1");
+    }
+
+    m_path = dir.filePath(QString("%1-%2.log").arg(baseName).arg(pid));
+    m_maxSize = maxSize;
+    m_size = 0;
+    // Not O_APPEND, which splice() does not support
+    m_fd = ::open(QFile::encodeName(m_path).constData(),
+                  O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    if (m_fd < 0) {
+        qDebug() << "# Cannot open" << m_path << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+bool ErrorLog::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+QString ErrorLog::path() const
+{
+    return m_path;
+}
+
+void ErrorLog::setForwardFd(int fd)
+{
+    m_forwardFd = fd;
+    struct stat st;
+    m_forwardIsPipe = fd >= 0 && fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+void ErrorLog::rotate()
+{
+    close(m_fd);
+    const QByteArray path = QFile::encodeName(m_path);
+    ::rename(path.constData(), (path + ".1").constData());
+    m_fd = ::open(path.constData(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    m_size = 0;
+}
+
+void ErrorLog::write(const char *data, int length)
+{
+    if (m_fd < 0)
+        return;
+    if (m_size >= m_maxSize)
+        rotate();
+    ssize_t n = ::write(m_fd, data, length);
+    if (n > 0)
+        m_size += n;
+}
+
+// Wait a little for room in the forward fd; stop forwarding if there is none
+bool ErrorLog::waitForForwardFd()
+{
+    struct pollfd fd = { m_forwardFd, POLLOUT, 0 };
+    int ready;
+    do {
+        ready = poll(&fd, 1, ForwardTimeoutMsecs);
+    } while (ready < 0 && errno == EINTR);
+    if (ready > 0)
+        return true;
+    qDebug() << "# Nobody reads the forwarded stderr, only logging to" << m_path;
+    m_forwardFd = -1;
+    return false;
+}
+
+void ErrorLog::forward(const char *data, size_t length)
+{
+    // Pieces of PIPE_BUF, so that a write never blocks once poll() reports room
+    while (length > 0 && m_forwardFd >= 0 && waitForForwardFd()) {
+        ssize_t n = ::write(m_forwardFd, data, std::min(length, size_t(PIPE_BUF)));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0) {
+            if (errno == EPIPE)
+                m_forwardFd = -1;
+            return;
+        }
+        data += n;
+        length -= size_t(n);
+    }
+}
+
+// Fallback through user space
+bool ErrorLog::copy(int pipeFd)
+{
+    char buffer[ChunkSize];
+    while (true) {
+        ssize_t n = read(pipeFd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return true; // EAGAIN; nothing more for now
+        if (n == 0)
+            return false;
+        write(buffer, int(n));
+        // What tee() has already duplicated before splicing stopped working
+        const size_t skip = std::min(m_teed, size_t(n));
+        m_teed -= skip;
+        forward(buffer + skip, size_t(n) - skip);
+    }
+}
+
+bool ErrorLog::transfer(int pipeFd)
+{
+    if (m_fd < 0)
+        return copy(pipeFd);
+#if defined(__linux__)
+    while (m_canSplice) {
+        if (m_size >= m_maxSize) {
+            rotate();
+            if (m_fd < 0)
+                return copy(pipeFd);
+        }
+
+        // tee() leaves the data in pipeFd, so that it can be spliced into the log
+        // afterwards; what a short splice() leaves behind has been tee'd already
+        size_t length = m_teed > 0 ? m_teed : ChunkSize;
+        if (m_forwardFd >= 0 && m_teed == 0) {
+            if (!m_forwardIsPipe) {
+                m_canSplice = false;
+                break;
+            }
+            ssize_t n = tee(pipeFd, m_forwardFd, length, SPLICE_F_NONBLOCK);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n == 0)
+                return false;
+            if (n > 0) {
+                length = m_teed = size_t(n);
+            } else if (errno == EPIPE) {
+                m_forwardFd = -1;
+            } else if (errno == EAGAIN) {
+                // Nothing to read, or the forward pipe is full; in the latter
+                // case, wait for room for a while
+                struct pollfd fd = { pipeFd, POLLIN, 0 };
+                if (poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN) && waitForForwardFd())
+                    continue;
+            }
+        }
+
+        ssize_t n = splice(pipeFd, nullptr, m_fd, nullptr, length,
+                           SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n == 0)
+            return false;
+        if (n < 0) {
+            if (errno == EAGAIN)
+                return true;
+            // E.g., a file system that does not support splice()
+            m_canSplice = false;
+            break;
+        }
+        m_size += n;
+        m_teed -= std::min(m_teed, size_t(n));
+    }
+#endif
+    return copy(pipeFd);
+}
@@ -0,0 +1,77 @@
+#ifndef ERRORLOG_H
+#define ERRORLOG_H
+
+#include <QString>
+
+#include <sys/types.h>
+
+/**
+ * @file ErrorLog.h
+ * @class ErrorLog
+ * @brief Size-capped log file for what an application writes to stderr after its error window.
+ *
+ * Logs are written to $XDG_STATE_HOME/launch/logs/<name>-<pid>.log
+ * (~/.local/state/launch/logs by default), so that a crash reporter can pick them up.
+ * When a log reaches its maximum size, it is renamed to <name>-<pid>.log.1 and a new one
+ * is started. Only the most recent logs of each application are kept.
+ *
+ * On Linux, stderr is moved from the pipe into the file with splice(), and duplicated
+ * to a forwarding pipe with tee(), so the data does not pass through user space.
+ * Elsewhere, and if the forwarding target is not a pipe, it is copied.
+ */
+class ErrorLog
+{
+public:
+    ErrorLog();
+    ~ErrorLog();
+
+    static QString directory();
+
+    /**
+     * Start the log for the process pid of the application name; removes old logs
+     * of the same application.
+     */
+    bool open(const QString &name, pid_t pid, qint64 maxSize = 1024 * 1024);
+    bool isOpen() const;
+    QString path() const;
+
+    /**
+     * Also send everything that is transferred to fd, e.g., our own stderr; -1 for nowhere.
+     * Forwarding stops if fd is closed on the other end, or stays full for a while.
+     */
+    void setForwardFd(int fd);
+
+    /**
+     * Write data to the log only, e.g., what has been collected before the log was opened.
+     */
+    void write(const char *data, int length);
+
+    /**
+     * Send data to the forward fd only, e.g., what has been collected before forwarding
+     * started. Never blocks for long; drops the data if the forward fd has no room.
+     */
+    void forward(const char *data, size_t length);
+
+    /**
+     * Move what is available on the non-blocking pipeFd into the log and to the forward fd.
+     *
+     * @return False once the other end of pipeFd has been closed.
+     */
+    bool transfer(int pipeFd);
+
+private:
+    int m_fd;
+    int m_forwardFd;
+    bool m_forwardIsPipe;
+    bool m_canSplice;
+    size_t m_teed; // At the head of the pipe, already duplicated to the forward fd
+    qint64 m_size;
+    qint64 m_maxSize;
+    QString m_path;
+
+    void rotate();
+    bool waitForForwardFd();
+    bool copy(int pipeFd);
+};
+
+#endif // ERRORLOG_H
@@ -0,0 +1,111 @@
+#include "ErrorOutputBuffer.h"
+
+#include <string.h>
+
+// Lines longer than this are matched in pieces
+static const int MaxLineLength = 4096;
+
+ErrorOutputBuffer::ErrorOutputBuffer(int headSize, int tailSize)
+    : m_headSize(headSize),
+      m_tailSize(tailSize),
+      m_tailStart(0),
+      m_dropped(0),
+      m_hasFatalLine(false)
+{
+}
+
+void ErrorOutputBuffer::setFatalLineMatcher(
+        const std::function<bool(const QByteArray &line)> &matcher)
+{
+    m_matcher = matcher;
+}
+
+void ErrorOutputBuffer::matchLines(const char *data, int length)
+{
+    if (!m_matcher || m_hasFatalLine)
+        return;
+    for (int i = 0; i < length && !m_hasFatalLine; i++) {
+        if (data[i] != '\n' && m_line.size() < MaxLineLength) {
+            m_line.append(data[i]);
+            continue;
+        }
+        if (m_matcher(m_line)) {
+            m_hasFatalLine = true;
+            m_fatalLine = m_line;
+        }
+        m_line.clear();
+        if (data[i] != '\n')
+            m_line.append(data[i]);
+    }
+}
+
+void ErrorOutputBuffer::append(const char *data, int length)
+{
+    matchLines(data, length);
+
+    int toHead = qMin(length, m_headSize - m_head.size());
+    if (toHead > 0) {
+        m_head.append(data, toHead);
+        data += toHead;
+        length -= toHead;
+    }
+    if (length <= 0)
+        return;
+
+    // Only the last m_tailSize bytes of what does not fit into the head are kept
+    if (length >= m_tailSize) {
+        m_dropped += m_tail.size() + length - m_tailSize;
+        m_tail = QByteArray(data + length - m_tailSize, m_tailSize);
+        m_tailStart = 0;
+        return;
+    }
+    int toAppend = qMin(length, m_tailSize - m_tail.size());
+    m_tail.append(data, toAppend);
+    data += toAppend;
+    length -= toAppend;
+    while (length > 0) {
+        int chunk = qMin(length, m_tailSize - m_tailStart);
+        memcpy(m_tail.data() + m_tailStart, data, chunk);
+        m_tailStart = (m_tailStart + chunk) % m_tailSize;
+        m_dropped += chunk;
+        data += chunk;
+        length -= chunk;
+    }
+}
+
+QByteArray ErrorOutputBuffer::contents() const
+{
+    QByteArray result = m_head;
+    if (m_dropped > 0) {
+        if (!result.endsWith('\n'))
+            result.append('\n');
+        result.append(QByteArray("[... ") + QByteArray::number(m_dropped)
+                      + " bytes omitted ...]\n");
+    }
+    result.append(m_tail.mid(m_tailStart));
+    result.append(m_tail.left(m_tailStart));
+    return result;
+}
+
+bool ErrorOutputBuffer::isEmpty() const
+{
+    return m_head.isEmpty();
+}
+
+void ErrorOutputBuffer::clear()
+{
+    m_head.clear();
+    m_tail.clear();
+    m_tailStart = 0;
+    m_dropped = 0;
+}
+
+bool ErrorOutputBuffer::hasFatalLine() const
+{
+    return m_hasFatalLine;
+}
+
+QByteArray ErrorOutputBuffer::fatalLine() const
+{
+    return m_fatalLine;
+}
@@ -0,0 +1,61 @@
+#ifndef ERROROUTPUTBUFFER_H
+#define ERROROUTPUTBUFFER_H
+
+#include <QByteArray>
+
+#include <functional>
+
+/**
+ * @file ErrorOutputBuffer.h
+ * @class ErrorOutputBuffer
+ * @brief Keeps the beginning and the end of what an application writes to stderr, in bounded memory.
+ *
+ * The first headSize bytes are kept as they are, since they usually contain the
+ * cause of a failure; after that, only the last tailSize bytes are kept in a ring.
+ * Complete lines are passed to a matcher as they come in, so that known fatal
+ * errors can be acted upon before the application exits.
+ */
+class ErrorOutputBuffer
+{
+public:
+    explicit ErrorOutputBuffer(int headSize = 16 * 1024, int tailSize = 48 * 1024);
+
+    /**
+     * Set a function that is called for each complete line (without the newline)
+     * until it returns true for the first time.
+     */
+    void setFatalLineMatcher(const std::function<bool(const QByteArray &line)> &matcher);
+
+    void append(const char *data, int length);
+
+    /**
+     * @return The kept output; if something had to be dropped in the middle, a
+     *         line saying how much is inserted between beginning and end.
+     */
+    QByteArray contents() const;
+
+    bool isEmpty() const;
+    void clear();
+
+    /**
+     * @return True if the matcher has returned true for a line.
+     */
+    bool hasFatalLine() const;
+    QByteArray fatalLine() const;
+
+private:
+    int m_headSize;
+    int m_tailSize;
+    QByteArray m_head;
+    QByteArray m_tail; // Ring of m_tailSize bytes once full
+    int m_tailStart;
+    qint64 m_dropped;
+    QByteArray m_line; // Incomplete last line, for the matcher
+    std::function<bool(const QByteArray &)> m_matcher;
+    QByteArray m_fatalLine;
+    bool m_hasFatalLine;
+
+    void matchLines(const char *data, int length);
+};
+
+#endif // ERROROUTPUTBUFFER_H
@@ -0,0 +1,226 @@
+#include "ErrorRules.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+ErrorRules::ErrorRules()
+{
+    ErrorRule kernelTooOld;
+    kernelTooOld.name = "kernel-too-old";
+    kernelTooOld.contains = "FATAL: kernel too old";
+    kernelTooOld.message = "The Linux compatibility layer reports an older kernel version than "
+                           "what is required to run this application.\n\n"
+                           "Please run\nsudo sysctl compat.linux.osrelease=5.0.0\nand try again.";
+    add(kernelTooOld);
+
+    ErrorRule chromiumSandbox;
+    chromiumSandbox.name = "chromium-sandbox";
+    chromiumSandbox.contains = "setuid_sandbox_host.cc";
+    chromiumSandbox.message = "Cannot run Chromium-based applications with a sandbox.\n"
+                              "Please try running it with the --no-sandbox argument.";
+    add(chromiumSandbox);
+
+    ErrorRule libraryVersion;
+    libraryVersion.name = "library-version";
+    libraryVersion.contains = "ld-elf.so.1: ";
+    libraryVersion.pattern.setPattern("ld-elf\\.so\\.1: (.*): version (.*) required by (.*) not found");
+    libraryVersion.message = "{title} application requires at least version {2} of {1:name} to run."
+                             "\n\nPlease update it and try again.";
+    libraryVersion.messageWithCommand = "{title} application requires at least version {2} of "
+                                        "{1:name} to run.\n\nPlease update it with\n{command}\n"
+                                        "and try again.";
+    libraryVersion.packageCapture = 1;
+    add(libraryVersion);
+
+    ErrorRule pythonModule;
+    pythonModule.name = "python-module";
+    pythonModule.contains = "ModuleNotFoundError: No module named '";
+    pythonModule.pattern.setPattern("ModuleNotFoundError: No module named '(.*)'");
+    pythonModule.message = "{title} requires the Python module {1} to run.\n\n"
+                           "Please install it and try again.";
+    // Applications often catch this for optional modules and keep running, so
+    // it is only reported if the application exits
+    pythonModule.fatal = false;
+    add(pythonModule);
+
+    // Most likely not relevant to the user
+    ErrorRule preloadNoise;
+    preloadNoise.name = "ld-preload-noise";
+    preloadNoise.contains = "from LD_PRELOAD cannot be preloaded";
+    preloadNoise.ignore = true;
+    preloadNoise.fatal = false;
+    add(preloadNoise);
+
+    ErrorRule versionInformationNoise;
+    versionInformationNoise.name = "version-information-noise";
+    versionInformationNoise.contains = "no version information available (required by";
+    versionInformationNoise.ignore = true;
+    versionInformationNoise.fatal = false;
+    add(versionInformationNoise);
+}
+
+const ErrorRules &ErrorRules::instance()
+{
+    static const ErrorRules rules = []() {
+        ErrorRules result;
+        // Most local first; load it last so that it wins
+        QStringList files = QStandardPaths::locateAll(QStandardPaths::GenericDataLocation,
+                                                      "launch/error-rules.conf");
+        std::reverse(files.begin(), files.end());
+        for (const QString &file : files)
+            result.load(file);
+        return result;
+    }();
+    return rules;
+}
+
+// QSettings splits unquoted values at commas
+static QString stringValue(const QSettings &settings, const QString &key)
+{
+    const QVariant value = settings.value(key);
+    if (value.type() == QVariant::StringList)
+        return value.toStringList().join(", ");
+    return value.toString();
+}
+
+void ErrorRules::load(const QString &path)
+{
+    QSettings settings(path, QSettings::IniFormat);
+    for (const QString &group : settings.childGroups()) {
+        settings.beginGroup(group);
+        ErrorRule rule;
+        rule.name = group;
+        rule.contains = stringValue(settings, "Contains").toUtf8();
+        rule.pattern.setPattern(stringValue(settings, "Pattern"));
+        rule.message = stringValue(settings, "Message");
+        rule.messageWithCommand = stringValue(settings, "MessageWithCommand");
+        rule.packageCapture = settings.value("PackageCapture", 0).toInt();
+        rule.ignore = settings.value("Ignore", false).toBool();
+        rule.fatal = settings.value("Fatal", !rule.ignore).toBool();
+        settings.endGroup();
+
+        if (rule.contains.isEmpty() && rule.pattern.pattern().isEmpty()) {
+            qWarning() << path << group << "needs Contains or Pattern";
+            continue;
+        }
+        if (!rule.pattern.isValid()) {
+            qWarning() << path << group << "has an invalid pattern:" << rule.pattern.errorString();
+            continue;
+        }
+        if (!rule.ignore && rule.message.isEmpty()) {
+            qWarning() << path << group << "needs a Message";
+            continue;
+        }
+        add(rule);
+    }
+}
+
+void ErrorRules::add(ErrorRule rule)
+{
+    rule.matcher.setPattern(rule.contains);
+    if (!rule.pattern.pattern().isEmpty())
+        rule.pattern.optimize();
+    for (ErrorRule &existing : m_rules) {
+        if (existing.name == rule.name) {
+            existing = rule;
+            return;
+        }
+    }
+    m_rules.push_back(rule);
+}
+
+const std::vector<ErrorRule> &ErrorRules::rules() const
+{
+    return m_rules;
+}
+
+// The first rule that matches the line; text is the line as a string, if it has
+// been converted already
+const ErrorRule *ErrorRules::matchLine(const QByteArray &line, const QString &text,
+                                       QStringList *captures, bool fatalOnly) const
+{
+    for (const ErrorRule &rule : m_rules) {
+        if (fatalOnly && (rule.ignore || !rule.fatal))
+            continue;
+        if (!rule.contains.isEmpty() && rule.matcher.indexIn(line) < 0)
+            continue;
+        if (!rule.pattern.pattern().isEmpty()) {
+            QRegularExpressionMatch m =
+                    rule.pattern.match(text.isNull() ? QString::fromUtf8(line) : text);
+            if (!m.hasMatch())
+                continue;
+            if (captures)
+                *captures = m.capturedTexts();
+        } else if (captures) {
+            *captures = QStringList { text.isNull() ? QString::fromUtf8(line) : text };
+        }
+        return &rule;
+    }
+    return nullptr;
+}
+
+ErrorMatch ErrorRules::match(const QString &text) const
+{
+    ErrorMatch result;
+    size_t best = m_rules.size();
+    for (const QString &line : text.split('\n')) {
+        QStringList captures;
+        const ErrorRule *rule = matchLine(line.toUtf8(), line, &captures, false);
+        if (rule && rule->ignore)
+            continue;
+        result.remainingLines.append(line);
+        if (rule && size_t(rule - m_rules.data()) < best) {
+            best = size_t(rule - m_rules.data());
+            result.rule = rule;
+            result.captures = captures;
+        }
+    }
+    return result;
+}
+
+bool ErrorRules::isFatalLine(const QByteArray &line) const
+{
+    return matchLine(line, QString(), nullptr, true) != nullptr;
+}
+
+QString ErrorRules::message(const ErrorMatch &match, const QString &title,
+                            const std::function<QString(const QString &path)> &packageUpdateCommand)
+{
+    if (!match.rule)
+        return QString();
+    const ErrorRule &rule = *match.rule;
+
+    QString command;
+    if (!rule.messageWithCommand.isEmpty() && rule.packageCapture > 0
+        && rule.packageCapture < match.captures.size())
+        command = packageUpdateCommand(match.captures.at(rule.packageCapture));
+    const QString &templateText = command.isEmpty() ? rule.message : rule.messageWithCommand;
+
+    static const QRegularExpression placeholder("\\{(title|command|\\d+)(:name)?\\}");
+    QString result;
+    int last = 0;
+    QRegularExpressionMatchIterator it = placeholder.globalMatch(templateText);
+    while (it.hasNext()) {
+        QRegularExpressionMatch m = it.next();
+        result.append(templateText.midRef(last, m.capturedStart() - last));
+        last = m.capturedEnd();
+        QString value;
+        if (m.captured(1) == "title") {
+            value = title;
+        } else if (m.captured(1) == "command") {
+            value = command;
+        } else {
+            int index = m.captured(1).toInt();
+            value = index < match.captures.size() ? match.captures.at(index) : QString();
+        }
+        if (!m.captured(2).isEmpty())
+            value = QFileInfo(value).fileName();
+        result.append(value);
+    }
+    result.append(templateText.midRef(last));
+    return result;
+}
@@ -0,0 +1,115 @@
+#ifndef ERRORRULES_H
+#define ERRORRULES_H
+
+#include <QByteArray>
+#include <QByteArrayMatcher>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include <functional>
+#include <vector>
+
+/**
+ * One way of turning a line an application wrote to stderr into clear text.
+ */
+struct ErrorRule
+{
+    QString name;
+    // A line has to contain this to be considered at all; checked before the pattern
+    QByteArray contains;
+    // Optional; its captures can be used in the messages as {1}, {2}, ...
+    QRegularExpression pattern;
+    // Shown to the user; {title} is the name of the application, {1:name} the
+    // file name part of capture 1
+    QString message;
+    // Used instead of message if a command for updating the package that contains
+    // capture packageCapture is known; the command is {command}
+    QString messageWithCommand;
+    int packageCapture = 0;
+    // Lines matching an ignore rule are dropped from what is shown otherwise
+    bool ignore = false;
+    // Reported as soon as the application writes it, not only once it has exited
+    bool fatal = true;
+
+    QByteArrayMatcher matcher;
+};
+
+/**
+ * The result of ErrorRules::match().
+ */
+struct ErrorMatch
+{
+    // The matching rule with the highest priority, or nullptr
+    const ErrorRule *rule = nullptr;
+    // The captures of its pattern; [0] is the whole line
+    QStringList captures;
+    // All lines that are not dropped by ignore rules
+    QStringList remainingLines;
+};
+
+/**
+ * @file ErrorRules.h
+ * @class ErrorRules
+ * @brief Table of known errors that Launcher::handleError() turns into clear text.
+ *
+ * The built-in rules can be extended and overridden with error-rules.conf files
+ * in the "launch" data directories, e.g., ~/.local/share/launch/error-rules.conf,
+ * with one group per rule:
+ *
+ *     [missing-gtk]
+ *     Contains=Gtk-WARNING **: cannot open display
+ *     Message="{title} needs a display to run."
+ *
+ * A group with the name of a built-in rule replaces it; other rules are tried after
+ * the built-in ones, in alphabetical order. Patterns are compiled once, and each
+ * line is first checked for the literal text of a rule, so matching stays linear
+ * in the size of the text.
+ */
+class ErrorRules
+{
+public:
+    /**
+     * @return The built-in rules plus the ones from the data files, loaded on first use.
+     */
+    static const ErrorRules &instance();
+
+    /**
+     * Only the built-in rules.
+     */
+    ErrorRules();
+
+    /**
+     * Add or replace rules from an INI file.
+     */
+    void load(const QString &path);
+
+    const std::vector<ErrorRule> &rules() const;
+
+    /**
+     * Go over text once, finding the first rule that matches any line and dropping
+     * lines that match ignore rules.
+     */
+    ErrorMatch match(const QString &text) const;
+
+    /**
+     * @return True if line matches a rule that is to be reported right away.
+     */
+    bool isFatalLine(const QByteArray &line) const;
+
+    /**
+     * The message of the rule of match for the application title; packageUpdateCommand
+     * is only called if the rule needs it.
+     */
+    static QString message(const ErrorMatch &match, const QString &title,
+                           const std::function<QString(const QString &path)> &packageUpdateCommand);
+
+private:
+    std::vector<ErrorRule> m_rules;
+
+    void add(ErrorRule rule);
+    const ErrorRule *matchLine(const QByteArray &line, const QString &text,
+                               QStringList *captures, bool fatalOnly) const;
+};
+
+#endif // ERRORRULES_H
@@ -4,8 +4,8 @@
 #include <QTextStream>
 #include <QMimeDatabase>
 #include <QDebug>
-#include <QMessageBox>
-#include <QProcess>
+#include "GuiHelper.h"
+#include "Platform.h"
 
 bool Executable::isExecutable(const QString& path) {
     QFileInfo fileInfo(path);
@@ -74,24 +74,12 @@ bool Executable::askUserToMakeExecutable(const QString& path) {
     if (!isExecutable(path)) {
         QString message = tr("The file is not executable:\n%1\n\nDo you want to make it executable?\n\nYou should only do this if you trust this file.")
                           .arg(path);
-        QMessageBox::StandardButton response = QMessageBox::question(nullptr, tr("Make Executable"), message,
-                                                                   QMessageBox::Yes | QMessageBox::No);
-
-        if (response == QMessageBox::Yes) {
-
-            QProcess process;
-            QStringList arguments;
-            arguments << "+x" << path;
-
-            process.setProgram("chmod");
-            process.setArguments(arguments);
-
-            process.start();
-            if (process.waitForFinished() && process.exitCode() == 0) {
+        if (GuiHelper::question(tr("Make Executable"), message)) {
+            if (Platform::makeExecutable(path)) {
                 // QMessageBox::information(nullptr, tr("Success"), tr("File is now executable."));
                 return true;
             } else {
-                QMessageBox::warning(nullptr, tr("Error"), tr("Failed to make the file executable."));
+                GuiHelper::warning(tr("Error"), tr("Failed to make the file executable."));
                 return false;
             }
         } else {
@@ -0,0 +1,97 @@
+#include "GuiHelper.h"
+
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFileInfo>
+#include <QProcess>
+#include <QStandardPaths>
+
+#include <stdio.h>
+
+QString GuiHelper::helperPath()
+{
+    // Prefer the helper that was built and installed together with us
+    QString candidate = QCoreApplication::applicationDirPath() + "/launch-gui";
+    if (QFileInfo(candidate).isExecutable())
+        return candidate;
+    return QStandardPaths::findExecutable("launch-gui");
+}
+
+bool GuiHelper::isAvailable()
+{
+    if (qEnvironmentVariableIsEmpty("DISPLAY") && qEnvironmentVariableIsEmpty("WAYLAND_DISPLAY"))
+        return false;
+    return !helperPath().isEmpty();
+}
+
+// Runs 'launch-gui' and waits for it, since dialogs are modal for us;
+// returns its exit code or -1 if it could not be run
+int GuiHelper::run(const QStringList &arguments, QString *output)
+{
+    if (!isAvailable())
+        return -1;
+
+    QProcess p;
+    p.setProgram(helperPath());
+    p.setArguments(arguments);
+    p.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    qDebug() << "# Spawning" << p.program() << arguments.first()
+             << "because this needs a graphical user interface";
+    p.start();
+    if (!p.waitForStarted() || !p.waitForFinished(-1) || p.exitStatus() != QProcess::NormalExit)
+        return -1;
+    if (output)
+        *output = QString::fromUtf8(p.readAllStandardOutput()).trimmed();
+    return p.exitCode();
+}
+
+// Messages need no answer, so we don't wait for them to be closed; this keeps
+// the supervisor and the D-Bus service responsive while a message is shown
+bool GuiHelper::show(const QStringList &arguments)
+{
+    if (!isAvailable())
+        return false;
+    qDebug() << "# Spawning" << helperPath() << arguments.first()
+             << "because this needs a graphical user interface";
+    return QProcess::startDetached(helperPath(), arguments);
+}
+
+void GuiHelper::warning(const QString &title, const QString &text)
+{
+    if (!show({ "warning", title, text }))
+        fprintf(stderr, "%s\n", qPrintable(text));
+}
+
+void GuiHelper::warningWithDetails(const QString &title, const QString &text,
+                                   const QString &detailedText)
+{
+    if (!show({ "details", title, text, detailedText }))
+        fprintf(stderr, "%s\n%s\n", qPrintable(text.trimmed()), qPrintable(detailedText));
+}
+
+bool GuiHelper::question(const QString &title, const QString &text)
+{
+    int result = run({ "question", title, text });
+    if (result < 0)
+        fprintf(stderr, "%s\n", qPrintable(text));
+    return result == 0;
+}
+
+QString GuiHelper::chooseApplication(const QString &fileOrProtocol, const QString &mimeType)
+{
+    QString selectedApplication;
+    if (run({ "choose", fileOrProtocol, mimeType }, &selectedApplication) != 0)
+        return QString();
+    return selectedApplication;
+}
+
+bool GuiHelper::activateWindowsOfBundle(const QString &bundle, const QList<qint64> &pids,
+                                        int waitMsecs)
+{
+    QStringList arguments = { "activate", bundle };
+    if (waitMsecs > 0)
+        arguments << "--wait" << QString::number(waitMsecs);
+    for (qint64 pid : pids)
+        arguments.append(QString::number(pid));
+    return run(arguments) == 0;
+}
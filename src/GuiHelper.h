@@ -0,0 +1,84 @@
+#ifndef GUIHELPER_H
+#define GUIHELPER_H
+
+#include <QString>
+#include <QStringList>
+
+/**
+ * @file GuiHelper.h
+ * @class GuiHelper
+ * @brief Shows dialogs and activates windows through the 'launch-gui' helper.
+ *
+ * The common path of 'launch' and 'open' (resolve, spawn, exit) shows no user
+ * interface at all, so the command line tools only depend on QtCore. Whenever
+ * a dialog is needed, this class executes 'launch-gui', which links Qt Widgets
+ * and XCB. Without a display (e.g., in headless sessions),
+ * messages are printed to stderr and questions are answered with "no".
+ */
+class GuiHelper
+{
+public:
+    /**
+     * Check whether dialogs can be shown.
+     *
+     * @return True if there is a display and 'launch-gui' can be found.
+     */
+    static bool isAvailable();
+
+    /**
+     * Show a warning message box without waiting for it to be closed.
+     *
+     * @param title The window title.
+     * @param text The message.
+     */
+    static void warning(const QString &title, const QString &text);
+
+    /**
+     * Show a warning message box with details that are hidden by default,
+     * without waiting for it to be closed.
+     *
+     * @param title The window title.
+     * @param text The message.
+     * @param detailedText The details, e.g., the error output of an application.
+     */
+    static void warningWithDetails(const QString &title, const QString &text,
+                                   const QString &detailedText);
+
+    /**
+     * Ask the user a yes/no question.
+     *
+     * @param title The window title.
+     * @param text The question.
+     * @return True if the user answered "yes".
+     */
+    static bool question(const QString &title, const QString &text);
+
+    /**
+     * Let the user choose an application to open a file or URL with.
+     *
+     * @param fileOrProtocol The file or URL to be opened.
+     * @param mimeType The MIME type of the file or URL.
+     * @return The name of the chosen application, or an empty string if the user cancelled.
+     */
+    static QString chooseApplication(const QString &fileOrProtocol, const QString &mimeType);
+
+    /**
+     * Bring the existing windows of a running bundle to the front.
+     *
+     * Only windows of processes running as the current user are activated.
+     *
+     * @param bundle The value of LAUNCHED_BUNDLE of the running application.
+     * @param pids The processes known to run it, whose windows are looked for first.
+     * @param waitMsecs How long to wait for pids to map a window if they have none yet.
+     * @return True if at least one window was activated.
+     */
+    static bool activateWindowsOfBundle(const QString &bundle, const QList<qint64> &pids = {},
+                                        int waitMsecs = 0);
+
+private:
+    static QString helperPath();
+    static int run(const QStringList &arguments, QString *output = nullptr);
+    static bool show(const QStringList &arguments);
+};
+
+#endif // GUIHELPER_H
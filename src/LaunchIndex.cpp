@@ -0,0 +1,174 @@
+#include "LaunchIndex.h"
+#include "ApplicationInfo.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QFileInfo>
+#include <QHash>
+#include <QStandardPaths>
+
+#include <algorithm>
+
+// A directory listing together with the modification time of the directory
+// at the time it was read; symlinks being added or removed change the
+// modification time of the directory, so this is enough to know when to re-read
+struct CachedListing
+{
+    qint64 mtime = -1;
+    QStringList entries;
+};
+
+class LaunchIndexPrivate
+{
+public:
+    CachedListing applications;
+    QHash<QString, CachedListing> handlers;
+};
+
+// Sort alphabetically and put .desktop files at the end, like DbManager does
+static void sortApplications(QStringList &applications)
+{
+    std::sort(applications.begin(), applications.end(), [](const QString &a, const QString &b) {
+        if (a.endsWith(".desktop") && !b.endsWith(".desktop")) {
+            return false;
+        } else if (!a.endsWith(".desktop") && b.endsWith(".desktop")) {
+            return true;
+        } else {
+            return a < b;
+        }
+    });
+}
+
+static qint64 directoryModificationTime(const QString &path)
+{
+    QFileInfo info(path);
+    if (!info.isDir())
+        return 0;
+    return info.lastModified().toMSecsSinceEpoch();
+}
+
+// Resolve all symlinks in a directory to their targets, skipping dangling ones
+// and the "Default" symlink used to mark the default application for a MIME type
+static QStringList readSymlinkTargets(const QString &path)
+{
+    QStringList targets;
+    const QFileInfoList entries =
+            QDir(path).entryInfoList(QDir::Files | QDir::Dirs | QDir::NoDotAndDotDot | QDir::System);
+    for (const QFileInfo &entry : entries) {
+        if (!entry.isSymLink() || entry.fileName() == "Default")
+            continue;
+        const QString target = entry.symLinkTarget();
+        if (QFileInfo::exists(target) && !targets.contains(target))
+            targets.append(target);
+    }
+    sortApplications(targets);
+    return targets;
+}
+
+static QString withoutBundleSuffix(const QString &path)
+{
+    const QStringList bundleSuffixes = { ".AppDir", ".app", ".desktop", ".AppImage", ".appimage" };
+    for (const QString &suffix : bundleSuffixes) {
+        if (path.endsWith(suffix, Qt::CaseInsensitive))
+            return path.left(path.length() - suffix.length());
+    }
+    return path;
+}
+
+// Targets can be deleted without the directory changing, e.g., when a bundle
+// is removed before the launch "database" is garbage collected
+static void removeMissing(QStringList &targets)
+{
+    for (int i = targets.size() - 1; i >= 0; i--) {
+        if (!QFileInfo::exists(targets.at(i)))
+            targets.removeAt(i);
+    }
+}
+
+LaunchIndex::LaunchIndex() : d(new LaunchIndexPrivate) { }
+
+LaunchIndex::~LaunchIndex()
+{
+    delete d;
+}
+
+QString LaunchIndex::applicationsPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation)
+            + "/launch/Applications/";
+}
+
+QString LaunchIndex::mimePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericDataLocation) + "/launch/MIME/";
+}
+
+QStringList LaunchIndex::applications()
+{
+    const QString path = applicationsPath();
+    const qint64 mtime = directoryModificationTime(path);
+    if (mtime != d->applications.mtime) {
+        d->applications.entries = readSymlinkTargets(path);
+        d->applications.mtime = mtime;
+    } else {
+        removeMissing(d->applications.entries);
+    }
+    return d->applications.entries;
+}
+
+QString LaunchIndex::applicationForName(const QString &name)
+{
+    QString wanted = withoutBundleSuffix(name);
+    while (wanted.endsWith("/"))
+        wanted.chop(1);
+    if (wanted.isEmpty())
+        return QString();
+
+    // Absolute names must match the whole path, plain names the last path component
+    if (!wanted.startsWith("/"))
+        wanted.prepend("/");
+
+    const QStringList candidates = applications();
+    for (const QString &candidate : candidates) {
+        if (withoutBundleSuffix(candidate).endsWith(wanted))
+            return candidate;
+    }
+    return QString();
+}
+
+QStringList LaunchIndex::handlersForMimeType(const QString &mimeType)
+{
+    const QString path = mimePath() + QString(mimeType).replace("/", "_");
+    const qint64 mtime = directoryModificationTime(path);
+    CachedListing &cached = d->handlers[mimeType];
+    if (mtime != cached.mtime) {
+        cached.entries = readSymlinkTargets(path);
+        cached.mtime = mtime;
+    } else {
+        removeMissing(cached.entries);
+    }
+    return cached.entries;
+}
+
+QString LaunchIndex::defaultHandlerForMimeType(const QString &mimeType)
+{
+    const QString defaultPath =
+            mimePath() + QString(mimeType).replace("/", "_") + "/Default";
+    const QFileInfo defaultInfo(defaultPath);
+    if (defaultInfo.isSymLink()) {
+        const QString target = defaultInfo.symLinkTarget();
+        if (QFileInfo::exists(target))
+            return target;
+    }
+
+    // Without a Default symlink, only an unambiguous choice is a default
+    const QStringList handlers = handlersForMimeType(mimeType);
+    if (handlers.length() == 1)
+        return handlers.first();
+    return QString();
+}
+
+QString LaunchIndex::bundlePathForPId(unsigned int pid)
+{
+    return ApplicationInfo::bundlePathForPId(pid);
+}
@@ -0,0 +1,115 @@
+#ifndef LAUNCHINDEX_H
+#define LAUNCHINDEX_H
+
+#include <QString>
+#include <QStringList>
+
+class LaunchIndexPrivate;
+
+/**
+ * @file LaunchIndex.h
+ * @class LaunchIndex
+ * @brief Read-only access to the launch "database" for other components.
+ *
+ * This class lets components such as Filer, Menu and Dock query the launch
+ * "database" in ~/.local/share/launch in-process instead of spawning 'launch'
+ * or 'bundle-thumbnailer -p'. It never modifies the database; adding and
+ * garbage collecting applications remains the job of DbManager.
+ *
+ * Results are cached and only re-read when the modification time of the
+ * underlying directory changes, so the methods are cheap enough to be called
+ * at UI frame rate; only the cached applications are checked to still exist.
+ * The returned lists are implicitly shared with the cache and hence not copied.
+ */
+class LaunchIndex
+{
+public:
+    /**
+     * Constructor.
+     *
+     * Creates an instance with an empty cache; nothing is read from disk yet.
+     */
+    LaunchIndex();
+
+    /**
+     * Destructor.
+     */
+    ~LaunchIndex();
+
+    LaunchIndex(const LaunchIndex &) = delete;
+    LaunchIndex &operator=(const LaunchIndex &) = delete;
+
+    /**
+     * Get all applications known to the system.
+     *
+     * Applications whose symlink target does not exist anymore are skipped.
+     * The list is sorted alphabetically with .desktop files at the end, in the
+     * same order that 'launch' uses.
+     *
+     * @return The paths of the application bundles.
+     */
+    QStringList applications();
+
+    /**
+     * Look up an application by name.
+     *
+     * Resolves names like "FeatherPad" or "FeatherPad.app" to the first
+     * application whose file name without bundle suffix is the name. An absolute
+     * name must match the whole path. This is stricter than 'launch', which takes
+     * the first application whose path merely ends in the name, so that "Pad"
+     * would find FeatherPad there but nothing here.
+     *
+     * @param name The name of the application, with or without bundle suffix.
+     * @return The path of the application bundle or an empty string.
+     */
+    QString applicationForName(const QString &name);
+
+    /**
+     * Get the applications that can open a MIME type.
+     *
+     * @param mimeType The MIME type, e.g., "text/plain" or "x-scheme-handler/https".
+     * @return The paths of the application bundles, sorted by name with .desktop files last.
+     */
+    QStringList handlersForMimeType(const QString &mimeType);
+
+    /**
+     * Get the default application for a MIME type.
+     *
+     * This is the target of the "Default" symlink if the user has chosen one,
+     * or the only application that can open the MIME type if there is exactly one,
+     * just like 'open' decides without asking the user.
+     *
+     * @param mimeType The MIME type, e.g., "text/plain".
+     * @return The path of the application bundle or an empty string.
+     */
+    QString defaultHandlerForMimeType(const QString &mimeType);
+
+    /**
+     * Get the bundle path for a given process ID.
+     *
+     * This is based on the LAUNCHED_BUNDLE environment variable set by 'launch'.
+     *
+     * @param pid The process ID.
+     * @return The bundle path or an empty string.
+     */
+    static QString bundlePathForPId(unsigned int pid);
+
+    /**
+     * Get the directory holding the symlinks to all known applications.
+     *
+     * @return The path, e.g., ~/.local/share/launch/Applications/
+     */
+    static QString applicationsPath();
+
+    /**
+     * Get the directory holding one subdirectory per MIME type.
+     *
+     * @return The path, e.g., ~/.local/share/launch/MIME/
+     */
+    static QString mimePath();
+
+private:
+    LaunchIndexPrivate *d; /**< Keeps the ABI stable when the cache changes. */
+};
+
+#endif // LAUNCHINDEX_H
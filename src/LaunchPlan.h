@@ -0,0 +1,54 @@
+#ifndef LAUNCHPLAN_H
+#define LAUNCHPLAN_H
+
+#include <QProcessEnvironment>
+#include <QString>
+#include <QStringList>
+
+/**
+ * @file LaunchPlan.h
+ * @class LaunchPlan
+ * @brief The result of resolving what 'launch' was asked to launch.
+ *
+ * A LaunchPlan holds everything that is needed to start the application:
+ * the executable, the arguments (with .desktop file field codes already expanded)
+ * and the bundle the executable belongs to. It is produced by Launcher::plan()
+ * and can be started by anything that can spawn a process.
+ */
+class LaunchPlan
+{
+public:
+    /**
+     * Check whether resolution succeeded.
+     *
+     * @return True if there is an executable to be launched.
+     */
+    bool isValid() const { return !executable.isEmpty(); }
+
+    /**
+     * Get the environment for the application to be launched.
+     *
+     * Sets LAUNCHED_EXECUTABLE and, for bundles, LAUNCHED_BUNDLE. A LAUNCHED_BUNDLE
+     * inherited from the base environment is removed so that nested launches
+     * won't leak it from parent to child application.
+     *
+     * @param base The environment to start from.
+     * @return The environment for the child process.
+     */
+    QProcessEnvironment environment(
+            const QProcessEnvironment &base = QProcessEnvironment::systemEnvironment()) const
+    {
+        QProcessEnvironment env = base;
+        env.insert("LAUNCHED_EXECUTABLE", executable);
+        env.remove("LAUNCHED_BUNDLE");
+        if (!bundle.isEmpty())
+            env.insert("LAUNCHED_BUNDLE", bundle);
+        return env;
+    }
+
+    QString executable; /**< The absolute path of the executable. */
+    QStringList arguments; /**< The arguments passed to the executable. */
+    QString bundle; /**< The canonical path of the bundle (.app, .AppDir, .AppImage, .desktop) or empty. */
+};
+
+#endif // LAUNCHPLAN_H
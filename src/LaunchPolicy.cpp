@@ -0,0 +1,284 @@
+#include "LaunchPolicy.h"
+
+#include <QDebug>
+#include <QFileInfo>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QStringList>
+
+#include <sched.h>
+#include <unistd.h>
+#if defined(__FreeBSD__)
+#  include <sys/param.h>
+#  include <sys/cpuset.h>
+#  include <sys/rtprio.h>
+#  include <sys/sysctl.h>
+#else
+#  include <sys/syscall.h>
+#endif
+
+#include <algorithm>
+
+struct NamedLimit
+{
+    const char *key;
+    int resource;
+};
+
+static const NamedLimit namedLimits[] = {
+    { "LimitCPU", RLIMIT_CPU },         { "LimitFSIZE", RLIMIT_FSIZE },
+    { "LimitDATA", RLIMIT_DATA },       { "LimitSTACK", RLIMIT_STACK },
+    { "LimitCORE", RLIMIT_CORE },       { "LimitNOFILE", RLIMIT_NOFILE },
+    { "LimitAS", RLIMIT_AS },           { "LimitNPROC", RLIMIT_NPROC },
+    { "LimitMEMLOCK", RLIMIT_MEMLOCK },
+};
+
+static const char *const ioClassNames[] = { "", "realtime", "best-effort", "idle" };
+static const char *const schedulerNames[] = { "other", "batch", "idle" };
+
+LaunchPolicy LaunchPolicy::forApplication(const QString &application)
+{
+    LaunchPolicy policy;
+    if (application.isEmpty())
+        return policy;
+    const QFileInfo info(application);
+    if (info.isDir()) {
+        const QString bundlePolicy = application + "/Resources/launch-policy.conf";
+        if (QFileInfo::exists(bundlePolicy))
+            policy.load(bundlePolicy);
+    }
+    const QString userPolicies =
+            QStandardPaths::writableLocation(QStandardPaths::GenericConfigLocation)
+            + "/launch/policies.conf";
+    if (QFileInfo::exists(userPolicies))
+        policy.load(userPolicies, info.completeBaseName());
+    return policy;
+}
+
+// QSettings splits unquoted values at commas
+static QString stringValue(const QSettings &settings, const QString &key)
+{
+    const QVariant value = settings.value(key);
+    if (value.type() == QVariant::StringList)
+        return value.toStringList().join(",");
+    return value.toString().trimmed();
+}
+
+// "0-3,6"
+static bool parseCpus(const QString &value, std::vector<int> *cpus)
+{
+    std::vector<int> result;
+    for (const QString &part : value.split(',')) {
+        if (part.trimmed().isEmpty())
+            continue;
+        bool firstOk = false, lastOk = false;
+        const int first = part.section('-', 0, 0).trimmed().toInt(&firstOk);
+        const int last = part.contains('-') ? part.section('-', 1, 1).trimmed().toInt(&lastOk)
+                                            : first;
+        if (!firstOk || (part.contains('-') && !lastOk) || first < 0 || last < first
+            || last >= CPU_SETSIZE)
+            return false;
+        for (int cpu = first; cpu <= last; cpu++)
+            result.push_back(cpu);
+    }
+    *cpus = result;
+    return true;
+}
+
+static bool parseLimitValue(const QString &value, rlim_t *limit)
+{
+    if (value == "infinity") {
+        *limit = RLIM_INFINITY;
+        return true;
+    }
+    bool ok = false;
+    const qulonglong number = value.toULongLong(&ok);
+    *limit = rlim_t(number);
+    return ok;
+}
+
+// "soft:hard", or one value for both
+static bool parseLimit(const QString &value, LaunchPolicy::ResourceLimit *limit)
+{
+    if (!parseLimitValue(value.section(':', 0, 0).trimmed(), &limit->soft))
+        return false;
+    if (!value.contains(':')) {
+        limit->hard = limit->soft;
+        return true;
+    }
+    return parseLimitValue(value.section(':', 1, 1).trimmed(), &limit->hard)
+            && (limit->hard == RLIM_INFINITY
+                || (limit->soft != RLIM_INFINITY && limit->soft <= limit->hard));
+}
+
+void LaunchPolicy::load(const QString &path, const QString &group)
+{
+    QSettings settings(path, QSettings::IniFormat);
+    if (!group.isEmpty()) {
+        if (!settings.childGroups().contains(group))
+            return;
+        settings.beginGroup(group);
+    }
+
+    for (const QString &key : settings.childKeys()) {
+        const QString value = stringValue(settings, key);
+        bool ok = false;
+        if (key == "Nice") {
+            const int level = value.toInt(&ok);
+            if (ok && level >= -20 && level <= 19) {
+                hasNice = true;
+                nice = level;
+            } else {
+                ok = false;
+            }
+        } else if (key == "IOSchedulingClass") {
+            for (int i = RealtimeIOClass; i <= IdleIOClass; i++) {
+                if (value == ioClassNames[i]) {
+                    ioClass = IOClass(i);
+                    ok = true;
+                }
+            }
+        } else if (key == "IOSchedulingPriority") {
+            const int priority = value.toInt(&ok);
+            if (ok && priority >= 0 && priority <= 7)
+                ioPriority = priority;
+            else
+                ok = false;
+        } else if (key == "CPUSchedulingPolicy") {
+            for (int i = DefaultScheduler; i <= IdleScheduler; i++) {
+                if (value == schedulerNames[i]) {
+                    scheduler = Scheduler(i);
+                    ok = true;
+                }
+            }
+        } else if (key == "CPUAffinity") {
+            ok = parseCpus(value, &cpus);
+        } else {
+            const NamedLimit *named = std::find_if(
+                    std::begin(namedLimits), std::end(namedLimits),
+                    [&key](const NamedLimit &candidate) { return key == candidate.key; });
+            if (named == std::end(namedLimits)) {
+                qDebug() << "# Unknown key" << key << "in" << path;
+                continue;
+            }
+            ResourceLimit limit = { named->resource, 0, 0 };
+            ok = parseLimit(value, &limit);
+            if (ok) {
+                limits.erase(std::remove_if(limits.begin(), limits.end(),
+                                            [&limit](const ResourceLimit &existing) {
+                                                return existing.resource == limit.resource;
+                                            }),
+                             limits.end());
+                limits.push_back(limit);
+            }
+        }
+        if (!ok)
+            qDebug() << "# Invalid value" << value << "for" << key << "in" << path;
+    }
+}
+
+bool LaunchPolicy::isEmpty() const
+{
+    return !hasNice && ioClass == DefaultIOClass && scheduler == DefaultScheduler
+            && cpus.empty() && limits.empty();
+}
+
+static QString limitValue(rlim_t limit)
+{
+    return limit == RLIM_INFINITY ? QString("infinity") : QString::number(qulonglong(limit));
+}
+
+QString LaunchPolicy::toString() const
+{
+    QStringList settings;
+    if (hasNice)
+        settings.append(QString("Nice=%1").arg(nice));
+    if (ioClass != DefaultIOClass) {
+        settings.append(QString("IOSchedulingClass=%1").arg(ioClassNames[ioClass]));
+        if (ioClass != IdleIOClass)
+            settings.append(QString("IOSchedulingPriority=%1").arg(ioPriority));
+    }
+    if (scheduler != DefaultScheduler)
+        settings.append(QString("CPUSchedulingPolicy=%1").arg(schedulerNames[scheduler]));
+    if (!cpus.empty()) {
+        QStringList list;
+        for (int cpu : cpus)
+            list.append(QString::number(cpu));
+        settings.append("CPUAffinity=" + list.join(','));
+    }
+    for (const ResourceLimit &limit : limits) {
+        for (const NamedLimit &named : namedLimits) {
+            if (named.resource == limit.resource)
+                settings.append(QString("%1=%2:%3")
+                                        .arg(named.key, limitValue(limit.soft),
+                                             limitValue(limit.hard)));
+        }
+    }
+    return settings.join(' ');
+}
+
+bool LaunchPolicy::apply(pid_t pid) const
+{
+    bool ok = true;
+    if (hasNice && setpriority(PRIO_PROCESS, id_t(pid), nice) != 0)
+        ok = false;
+
+#if defined(__FreeBSD__)
+    if (scheduler == IdleScheduler) {
+        struct rtprio rtp;
+        rtp.type = RTP_PRIO_IDLE;
+        rtp.prio = RTP_PRIO_MAX;
+        if (rtprio(RTP_SET, pid, &rtp) != 0)
+            ok = false;
+    }
+    if (!cpus.empty()) {
+        cpuset_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+            CPU_SET(cpu, &set);
+        if (cpuset_setaffinity(CPU_LEVEL_WHICH, CPU_WHICH_PID, pid == 0 ? -1 : id_t(pid),
+                               sizeof(set), &set)
+            != 0)
+            ok = false;
+    }
+    for (const ResourceLimit &limit : limits) {
+        const struct rlimit value = { limit.soft, limit.hard };
+        if (pid == 0) {
+            if (setrlimit(limit.resource, &value) != 0)
+                ok = false;
+        } else {
+            int name[] = { CTL_KERN, KERN_PROC, KERN_PROC_RLIMIT, int(pid), limit.resource };
+            if (sysctl(name, 5, nullptr, nullptr, &value, sizeof(value)) != 0)
+                ok = false;
+        }
+    }
+#else
+    if (ioClass != DefaultIOClass) {
+        // IOPRIO_WHO_PROCESS; the level is ignored in the idle class
+        const int ioprio = (int(ioClass) << 13) | ioPriority;
+        if (syscall(SYS_ioprio_set, 1, int(pid), ioprio) != 0)
+            ok = false;
+    }
+    if (scheduler != DefaultScheduler) {
+        struct sched_param param = {};
+        if (sched_setscheduler(pid, scheduler == IdleScheduler ? SCHED_IDLE : SCHED_BATCH,
+                               &param)
+            != 0)
+            ok = false;
+    }
+    if (!cpus.empty()) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        for (int cpu : cpus)
+            CPU_SET(cpu, &set);
+        if (sched_setaffinity(pid, sizeof(set), &set) != 0)
+            ok = false;
+    }
+    for (const ResourceLimit &limit : limits) {
+        const struct rlimit value = { limit.soft, limit.hard };
+        if (prlimit(pid, limit.resource, &value, nullptr) != 0)
+            ok = false;
+    }
+#endif
+    return ok;
+}
@@ -0,0 +1,85 @@
+#ifndef LAUNCHPOLICY_H
+#define LAUNCHPOLICY_H
+
+#include <QString>
+
+#include <sys/resource.h>
+#include <sys/types.h>
+
+#include <vector>
+
+/**
+ * @file LaunchPolicy.h
+ * @class LaunchPolicy
+ * @brief Nice level, I/O and CPU scheduling, CPU affinity and resource limits
+ *        an application is started with.
+ *
+ * Without a policy, applications run with those of the launcher. A bundle can
+ * ship one in Resources/launch-policy.conf, and the user can set or override
+ * one per application in ~/.config/launch/policies.conf, in a group named
+ * after the bundle without its suffix (or after the executable):
+ *
+ *     [Syncthing]
+ *     Nice=10
+ *     IOSchedulingClass=idle
+ *     CPUSchedulingPolicy=batch
+ *     CPUAffinity=0-1
+ *     LimitNOFILE=4096:8192
+ *
+ * The keys are named like those of systemd.exec(5). Values the user may not set,
+ * such as a negative nice level without privileges, are left as they are. There
+ * is no per-process I/O priority on FreeBSD, and no batch scheduling.
+ */
+class LaunchPolicy
+{
+public:
+    enum Scheduler { DefaultScheduler, BatchScheduler, IdleScheduler };
+    enum IOClass { DefaultIOClass, RealtimeIOClass, BestEffortIOClass, IdleIOClass };
+
+    struct ResourceLimit
+    {
+        int resource; /**< RLIMIT_NOFILE etc. */
+        rlim_t soft;
+        rlim_t hard;
+    };
+
+    /**
+     * @param application The bundle, or the executable if there is none.
+     * @return The policy of the bundle with the user's settings on top.
+     */
+    static LaunchPolicy forApplication(const QString &application);
+
+    /**
+     * Add or replace settings from group of an INI file; the top level if group is empty.
+     */
+    void load(const QString &path, const QString &group = QString());
+
+    bool isEmpty() const;
+
+    /**
+     * @return The settings in the syntax of the files, for the launch trace.
+     */
+    QString toString() const;
+
+    /**
+     * Apply the policy to a process that has just been started.
+     *
+     * Only makes system calls, so that it can be called between vfork() and
+     * execve(). On Linux, scheduling and affinity only apply to the main thread of
+     * another process; its later threads inherit them.
+     *
+     * @param pid The process, or 0 for the calling one.
+     * @return False if a setting could not be applied.
+     */
+    bool apply(pid_t pid = 0) const;
+
+    bool hasNice = false;
+    int nice = 0;
+    IOClass ioClass = DefaultIOClass;
+    int ioPriority = 4; /**< 0 (highest) to 7; for the realtime and best-effort classes. */
+    Scheduler scheduler = DefaultScheduler;
+    std::vector<int> cpus; /**< The CPUs it may run on; all if empty. */
+    std::vector<ResourceLimit> limits;
+};
+
+#endif // LAUNCHPOLICY_H
@@ -0,0 +1,92 @@
+#include "LaunchService.h"
+#include "launcher.h"
+
+#include <QDBusError>
+#include <QDebug>
+
+LaunchService::LaunchService(QObject *parent) : QObject(parent), launcher(new Launcher())
+{
+    // Waiting for launch-gui would block all other callers, since the service
+    // handles one call at a time; errors are returned to the caller instead
+    launcher->setInteractive(false);
+    launcher->discoverApplications();
+}
+
+LaunchService::~LaunchService()
+{
+    delete launcher;
+}
+
+// Send a D-Bus error reply instead of the normal return value
+void LaunchService::fail(const QString &message)
+{
+    qDebug() << "# Request failed:" << message;
+    if (calledFromDBus()) {
+        sendErrorReply(QDBusError::Failed, message);
+    }
+}
+
+QString LaunchService::Resolve(const QString &path)
+{
+    QString document = path;
+    QString application = launcher->applicationForDocument(document);
+    if (application.isEmpty()) {
+        fail(launcher->errorString());
+    }
+    return application;
+}
+
+bool LaunchService::Open(const QStringList &paths)
+{
+    QStringList errors;
+    // One instance per application for all of its documents, where it accepts several
+    const QList<QStringList> requests =
+            launcher->launchRequestsForDocuments(paths, false, &errors);
+    for (const QStringList &request : requests) {
+        if (!launcher->startLaunch(request)) {
+            errors.append(launcher->errorString());
+        }
+    }
+
+    if (!errors.isEmpty()) {
+        fail(errors.join("\n"));
+        return false;
+    }
+    return true;
+}
+
+bool LaunchService::Launch(const QString &application, const QStringList &arguments)
+{
+    QStringList args = arguments;
+    args.prepend(application);
+    if (!launcher->startLaunch(args)) {
+        fail(launcher->errorString());
+        return false;
+    }
+    return true;
+}
+
+bool LaunchService::Prepare(const QStringList &paths)
+{
+    QStringList errors;
+    for (const QString &path : paths) {
+        if (launcher->prepare({ path }, true) != 0)
+            errors.append(launcher->errorString());
+    }
+    if (!errors.isEmpty()) {
+        fail(errors.join("\n"));
+        return false;
+    }
+    return true;
+}
+
+bool LaunchService::PrepareLaunch(const QString &application, const QStringList &arguments)
+{
+    QStringList args = arguments;
+    args.prepend(application);
+    if (launcher->prepare(args, false) != 0) {
+        fail(launcher->errorString());
+        return false;
+    }
+    return true;
+}
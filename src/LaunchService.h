@@ -0,0 +1,113 @@
+#ifndef LAUNCHSERVICE_H
+#define LAUNCHSERVICE_H
+
+#include <QObject>
+#include <QDBusContext>
+#include <QStringList>
+
+class Launcher;
+
+/**
+ * @file LaunchService.h
+ * @class LaunchService
+ * @brief Resolves and launches applications on behalf of other processes over D-Bus.
+ *
+ * Filer, Menu and other applications can call this service on the session bus
+ * (service "local.Launch", path "/") instead of spawning 'open' or 'launch',
+ * so that opening a document costs one IPC call instead of a full process startup.
+ * The service keeps one Launcher, and hence the launch "database", warm.
+ *
+ * The service itself never shows dialogs, since it handles one call at a time
+ * and would keep all other callers waiting meanwhile. Where 'open' would let the
+ * user choose an application, or the request can't be resolved, the call fails
+ * with the message instead; callers that want the dialog can run 'open' or
+ * 'launch' then. Resolved requests are handed to a 'launch' process of their
+ * own, which activates a running instance, checks and limits the application,
+ * notifies Menu and shows errors the application reports, like the command does.
+ *
+ * Prepare() and PrepareLaunch() do everything but start the process, e.g., when
+ * the pointer rests on an item; an Open() or Launch() of the same item within
+ * PlanCache::MaxAgeMsecs then only has to start it.
+ */
+class LaunchService : public QObject, protected QDBusContext
+{
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "local.Launch")
+
+public:
+    /**
+     * Constructor.
+     *
+     * Discovers the applications on well-known paths. Applications installed later
+     * are discovered when a lookup by name or MIME type finds nothing.
+     *
+     * @param parent The parent object.
+     */
+    explicit LaunchService(QObject *parent = nullptr);
+
+    /**
+     * Destructor.
+     */
+    ~LaunchService();
+
+public slots:
+    /**
+     * Get the application that Open() would use for a document.
+     *
+     * Never shows any dialogs. Executables and .desktop files resolve to themselves.
+     *
+     * @param path The document, URL or application to be resolved.
+     * @return The path or name of the application, or a D-Bus error if there is none.
+     */
+    QString Resolve(const QString &path);
+
+    /**
+     * Open documents or URLs with their default applications.
+     *
+     * Documents for the same application are passed to one instance of it,
+     * unless it takes one file at a time (%f or %u in its .desktop file).
+     *
+     * @param paths The documents or URLs to be opened.
+     * @return True if a 'launch' was started for all paths.
+     */
+    bool Open(const QStringList &paths);
+
+    /**
+     * Launch an application, like the 'launch' command does.
+     *
+     * @param application The path or name of the application.
+     * @param arguments The arguments passed to the application.
+     * @return True if a 'launch' was started for the application; errors after
+     *         that are shown by it rather than returned.
+     */
+    bool Launch(const QString &application, const QStringList &arguments);
+
+    /**
+     * Resolve documents or URLs like Open() would, and read the files of their
+     * applications into the page cache, like 'open --prepare' does.
+     *
+     * Never shows any dialogs.
+     *
+     * @param paths The documents or URLs that are likely to be opened.
+     * @return True if there is an application for all paths.
+     */
+    bool Prepare(const QStringList &paths);
+
+    /**
+     * Resolve an application like Launch() would, and read its files into the
+     * page cache, like 'launch --prepare' does.
+     *
+     * Never shows any dialogs.
+     *
+     * @param application The path or name of the application.
+     * @param arguments The arguments that will be passed to the application.
+     * @return True if the application can be launched.
+     */
+    bool PrepareLaunch(const QString &application, const QStringList &arguments);
+
+private:
+    Launcher *launcher;
+    void fail(const QString &message);
+};
+
+#endif // LAUNCHSERVICE_H
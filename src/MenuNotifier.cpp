@@ -0,0 +1,55 @@
+#include "MenuNotifier.h"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusPendingCall>
+#include <QDebug>
+#include <QList>
+
+#include <algorithm>
+
+static QList<QDBusPendingCall> pendingCalls;
+
+// Built once; each notification only copies it and sets its arguments
+static QDBusMessage menuMessage(const QString &method)
+{
+    QDBusMessage message = QDBusMessage::createMethodCall("local.Menu", "/", QString(), method);
+    message.setAutoStartService(false);
+    return message;
+}
+
+static void send(QDBusMessage message, const QVariantList &arguments)
+{
+    QDBusConnection bus = QDBusConnection::sessionBus();
+    if (!bus.isConnected()) {
+        qDebug() << "# Not telling Menu since there is no session bus";
+        return;
+    }
+    message.setArguments(arguments);
+    // The supervisor notifies for as long as it runs
+    pendingCalls.erase(std::remove_if(pendingCalls.begin(), pendingCalls.end(),
+                                      [](const QDBusPendingCall &call) { return call.isFinished(); }),
+                       pendingCalls.end());
+    // Returns right away; the reply, if any, is dropped
+    pendingCalls.append(bus.asyncCall(message, MenuNotifier::TimeoutMsecs));
+    qDebug() << "# Told Menu" << message.member() << arguments;
+}
+
+void MenuNotifier::showApplicationName(const QString &name)
+{
+    static const QDBusMessage message = menuMessage("showApplicationName");
+    send(message, { name });
+}
+
+void MenuNotifier::hideApplicationName()
+{
+    static const QDBusMessage message = menuMessage("hideApplicationName");
+    send(message, {});
+}
+
+void MenuNotifier::flush()
+{
+    for (QDBusPendingCall &call : pendingCalls)
+        call.waitForFinished();
+    pendingCalls.clear();
+}
@@ -0,0 +1,42 @@
+#ifndef MENUNOTIFIER_H
+#define MENUNOTIFIER_H
+
+#include <QString>
+
+/**
+ * @file MenuNotifier.h
+ * @class MenuNotifier
+ * @brief Tells Menu which application is being launched, without waiting for it.
+ *
+ * The messages are sent to local.Menu on the session bus as method calls that
+ * nobody waits for. Unlike QDBusInterface, this does not introspect Menu first,
+ * and a Menu that is stuck or not running can't hold up launching; its replies
+ * are dropped after a short timeout. Menu is not started for these messages.
+ */
+class MenuNotifier
+{
+public:
+    /**
+     * Show name in the menu bar while the application is starting.
+     */
+    static void showApplicationName(const QString &name);
+
+    /**
+     * The application has failed to start; stop showing its name.
+     */
+    static void hideApplicationName();
+
+    /**
+     * Before exiting right after a notification: the messages are sent by the
+     * D-Bus thread of Qt, which does not outlive us. Waits for the replies,
+     * for at most TimeoutMsecs.
+     */
+    static void flush();
+
+    /**
+     * How long a reply from Menu is waited for in the background.
+     */
+    static const int TimeoutMsecs = 500;
+};
+
+#endif // MENUNOTIFIER_H
@@ -0,0 +1,283 @@
+#include "PackageIndex.h"
+
+#include <QDebug>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QProcess>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <string.h>
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+static const char IndexMagic[] = "launch-package-index 1";
+
+// A package manager whose database the index can be built from
+struct PackageDatabase
+{
+    QString backend;
+    // Its modification time tells whether the index is up to date
+    QString path;
+    qint64 modified = 0;
+    // %1 is the package name
+    QString commandTemplate;
+};
+
+static bool findPackageDatabase(PackageDatabase *database)
+{
+    struct Candidate
+    {
+        const char *backend;
+        const char *path;
+    };
+    static const Candidate candidates[] = {
+        { "pkg", "/var/db/pkg/local.sqlite" },
+        { "dpkg", "/var/lib/dpkg/status" },
+        { "apk", "/lib/apk/db/installed" },
+        { "rpm", "/var/lib/rpm/rpmdb.sqlite" },
+        { "rpm", "/usr/lib/sysimage/rpm/rpmdb.sqlite" },
+        { "rpm", "/var/lib/rpm/Packages" },
+    };
+    for (const Candidate &candidate : candidates) {
+        QFileInfo info(candidate.path);
+        if (!info.exists())
+            continue;
+        database->backend = candidate.backend;
+        database->path = candidate.path;
+        database->modified = info.lastModified().toMSecsSinceEpoch();
+        if (database->backend == "pkg") {
+            database->commandTemplate = "sudo pkg install %1";
+        } else if (database->backend == "dpkg") {
+            database->commandTemplate = "sudo apt install %1";
+        } else if (database->backend == "apk") {
+            database->commandTemplate = "sudo apk add --upgrade %1";
+        } else if (!QStandardPaths::findExecutable("dnf").isEmpty()) {
+            database->commandTemplate = "sudo dnf install %1";
+        } else if (!QStandardPaths::findExecutable("zypper").isEmpty()) {
+            database->commandTemplate = "sudo zypper install %1";
+        } else {
+            database->commandTemplate = "sudo yum install %1";
+        }
+        return true;
+    }
+    return false;
+}
+
+static QByteArray indexHeader(const PackageDatabase &database)
+{
+    return QByteArray(IndexMagic) + '\t' + database.backend.toUtf8() + '\t'
+            + database.path.toUtf8() + '\t' + QByteArray::number(database.modified) + '\t'
+            + database.commandTemplate.toUtf8() + '\n';
+}
+
+typedef std::vector<std::pair<QByteArray, QByteArray>> Entries;
+
+// /var/lib/dpkg/info/<package>[:<architecture>].list has one installed path per line
+static void collectDpkg(Entries &entries)
+{
+    QDir info("/var/lib/dpkg/info");
+    for (const QString &list : info.entryList({ "*.list" }, QDir::Files)) {
+        QByteArray package = list.left(list.length() - 5).section(':', 0, 0).toUtf8();
+        QFile file(info.filePath(list));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        for (const QByteArray &line : file.readAll().split('\n')) {
+            if (line.startsWith('/'))
+                entries.emplace_back(line, package);
+        }
+    }
+}
+
+// Records separated by empty lines, with P:<package>, F:<directory> and R:<file in directory>
+static void collectApk(Entries &entries)
+{
+    QFile file("/lib/apk/db/installed");
+    if (!file.open(QIODevice::ReadOnly))
+        return;
+    QByteArray package, directory;
+    for (const QByteArray &line : file.readAll().split('\n')) {
+        if (line.startsWith("P:"))
+            package = line.mid(2);
+        else if (line.startsWith("F:"))
+            directory = line.mid(2);
+        else if (line.startsWith("R:"))
+            entries.emplace_back('/' + directory + '/' + line.mid(2), package);
+    }
+}
+
+// For databases we can't read ourselves; program prints "path<TAB>package" lines
+static void collectFromProgram(Entries &entries, const QString &program,
+                               const QStringList &arguments)
+{
+    QProcess p;
+    qDebug() << "# Spawning" << program
+             << "because only it can read its database; once per index update";
+    p.start(program, arguments);
+    if (!p.waitForFinished(60 * 1000)) {
+        qDebug() << "# Could not run" << program << p.errorString();
+        return;
+    }
+    for (const QByteArray &line : p.readAllStandardOutput().split('\n')) {
+        int tab = line.indexOf('\t');
+        if (tab > 0 && line.startsWith('/'))
+            entries.emplace_back(line.left(tab), line.mid(tab + 1));
+    }
+}
+
+QString PackageIndex::indexPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/launch/package-index";
+}
+
+// The first line of the index, or an empty QByteArray
+static QByteArray readHeader()
+{
+    QFile file(PackageIndex::indexPath());
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readLine(4096);
+}
+
+bool PackageIndex::refresh()
+{
+    PackageDatabase database;
+    if (!findPackageDatabase(&database))
+        return false;
+    const QByteArray header = indexHeader(database);
+    if (readHeader() == header)
+        return true;
+
+    qDebug() << "# Building package index from" << database.path;
+    Entries entries;
+    if (database.backend == "dpkg")
+        collectDpkg(entries);
+    else if (database.backend == "apk")
+        collectApk(entries);
+    else if (database.backend == "pkg")
+        collectFromProgram(entries, "pkg", { "query", "-a", "%Fp\t%n" });
+    else
+        collectFromProgram(entries, "rpm", { "-qa", "--qf", "[%{FILENAMES}\t%{NAME}\n]" });
+
+    // Sorted by path for the binary search; directories are listed by many packages
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const std::pair<QByteArray, QByteArray> &a,
+                        const std::pair<QByteArray, QByteArray> &b) { return a.first < b.first; });
+    entries.erase(std::unique(entries.begin(), entries.end(),
+                              [](const std::pair<QByteArray, QByteArray> &a,
+                                 const std::pair<QByteArray, QByteArray> &b) {
+                                  return a.first == b.first;
+                              }),
+                  entries.end());
+
+    QDir().mkpath(QFileInfo(indexPath()).path());
+    QSaveFile file(indexPath());
+    if (!file.open(QIODevice::WriteOnly)) {
+        qDebug() << "# Cannot write" << indexPath();
+        return false;
+    }
+    file.write(header);
+    for (const auto &entry : entries) {
+        file.write(entry.first);
+        file.write("\t", 1);
+        file.write(entry.second);
+        file.write("\n", 1);
+    }
+    return file.commit();
+}
+
+// Binary search over the lines between begin and end, which start with a path and a tab
+static QByteArray findInIndex(const char *begin, const char *end, const QByteArray &path)
+{
+    const char *low = begin;
+    const char *high = end;
+    while (low < high) {
+        const char *line = low + (high - low) / 2;
+        while (line > low && line[-1] != '\n')
+            line--;
+        const char *lineEnd = static_cast<const char *>(memchr(line, '\n', end - line));
+        if (lineEnd == nullptr)
+            lineEnd = end;
+        const char *tab = static_cast<const char *>(memchr(line, '\t', lineEnd - line));
+        if (tab == nullptr)
+            return QByteArray(); // Corrupt
+
+        int keyLength = int(tab - line);
+        int cmp = memcmp(line, path.constData(), size_t(qMin(keyLength, path.size())));
+        if (cmp == 0)
+            cmp = keyLength - path.size();
+        if (cmp == 0)
+            return QByteArray(tab + 1, int(lineEnd - tab - 1));
+        if (cmp < 0)
+            low = lineEnd + 1;
+        else
+            high = line;
+    }
+    return QByteArray();
+}
+
+// Returns the package and the command template for it
+static bool lookUp(const QString &path, QString *package, QString *commandTemplate)
+{
+    PackageDatabase database;
+    if (!findPackageDatabase(&database))
+        return false;
+    // Rebuilding takes seconds, so an outdated index is used as it is; it still
+    // knows all packages but the latest changes, and launch-service and the
+    // supervisor rebuild it when they start. Only without any index is it built
+    // here, so that even the first error can name the package
+    if (readHeader().isEmpty())
+        PackageIndex::refresh();
+
+    QFile file(PackageIndex::indexPath());
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0)
+        return false;
+    const char *data = reinterpret_cast<const char *>(file.map(0, file.size()));
+    if (data == nullptr)
+        return false;
+    const char *end = data + file.size();
+    const char *entries = static_cast<const char *>(memchr(data, '\n', end - data));
+    if (entries == nullptr)
+        return false;
+    entries++;
+
+    // Packages may list a path through a symlink, e.g., /lib instead of /usr/lib
+    // on systems with a merged /usr
+    QByteArray result = findInIndex(entries, end, QFile::encodeName(path));
+    if (result.isEmpty()) {
+        const QString canonicalPath = QFileInfo(path).canonicalFilePath();
+        if (!canonicalPath.isEmpty() && canonicalPath != path)
+            result = findInIndex(entries, end, QFile::encodeName(canonicalPath));
+        if (result.isEmpty() && canonicalPath.startsWith("/usr/")) {
+            const QString withoutUsr = canonicalPath.mid(4);
+            if (QFileInfo(withoutUsr).canonicalFilePath() == canonicalPath)
+                result = findInIndex(entries, end, QFile::encodeName(withoutUsr));
+        }
+    }
+    if (result.isEmpty())
+        return false;
+    *package = QString::fromUtf8(result);
+    *commandTemplate = database.commandTemplate;
+    return true;
+}
+
+QString PackageIndex::packageForFile(const QString &path)
+{
+    QString package, commandTemplate;
+    if (!lookUp(path, &package, &commandTemplate))
+        return QString();
+    return package;
+}
+
+QString PackageIndex::updateCommand(const QString &path)
+{
+    QString package, commandTemplate;
+    if (!lookUp(path, &package, &commandTemplate))
+        return QString();
+    return commandTemplate.arg(package);
+}
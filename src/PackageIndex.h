@@ -0,0 +1,46 @@
+#ifndef PACKAGEINDEX_H
+#define PACKAGEINDEX_H
+
+#include <QString>
+
+/**
+ * @file PackageIndex.h
+ * @class PackageIndex
+ * @brief Which package an installed file belongs to, without asking the package manager.
+ *
+ * The index is built from the database of the package manager on disk and kept in
+ * ~/.cache/launch/package-index as lines of "path<TAB>package", sorted by path.
+ * Lookups map that file and binary search it, so they take microseconds. The index
+ * is rebuilt when the modification time of the package database changes, by
+ * launch-service and 'launch --supervise' when they start. Lookups use an outdated
+ * index as it is, and only build one if there is none yet.
+ *
+ * Supported are pkg (FreeBSD), dpkg, apk and rpm. dpkg and apk databases are read
+ * directly; for pkg and rpm, whose databases are SQLite or Berkeley DB, the package
+ * manager is asked once for all files while building the index.
+ */
+class PackageIndex
+{
+public:
+    /**
+     * @return The name of the package that has installed path, or an empty string.
+     */
+    static QString packageForFile(const QString &path);
+
+    /**
+     * @return The command that installs or updates the package that has installed
+     *         path, e.g., "sudo pkg install libfoo", or an empty string.
+     */
+    static QString updateCommand(const QString &path);
+
+    /**
+     * Rebuild the index if the package database has changed since it was built.
+     *
+     * @return False if there is no supported package manager or the index cannot be written.
+     */
+    static bool refresh();
+
+    static QString indexPath();
+};
+
+#endif // PACKAGEINDEX_H
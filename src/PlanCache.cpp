@@ -0,0 +1,125 @@
+#include "PlanCache.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+static const quint32 EntryMagic = 0x6c706331; // "lpc1"
+
+QString PlanCache::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+            + "/launch/plans";
+}
+
+// Relative paths resolve differently in another working directory
+static QString entryPath(const QString &kind, const QStringList &request)
+{
+    QByteArray key = kind.toUtf8() + '\0' + QDir::currentPath().toUtf8();
+    for (const QString &argument : request)
+        key += '\0' + argument.toUtf8();
+    return PlanCache::directory() + "/"
+            + QCryptographicHash::hash(key, QCryptographicHash::Sha1).toHex();
+}
+
+static void removeExpired()
+{
+    const qint64 now = QDateTime::currentMSecsSinceEpoch();
+    QDir dir(PlanCache::directory());
+    for (const QFileInfo &info : dir.entryInfoList(QDir::Files)) {
+        if (now - info.lastModified().toMSecsSinceEpoch() > PlanCache::MaxAgeMsecs)
+            QFile::remove(info.filePath());
+    }
+}
+
+static void store(const QString &path, const QStringList &fields)
+{
+    removeExpired();
+    QDir().mkpath(PlanCache::directory());
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream << EntryMagic << QDateTime::currentMSecsSinceEpoch() << fields;
+    file.commit();
+}
+
+static bool find(const QString &path, QStringList *fields)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream stream(&file);
+    stream.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0;
+    qint64 created = 0;
+    stream >> magic >> created >> *fields;
+    if (stream.status() != QDataStream::Ok || magic != EntryMagic
+        || QDateTime::currentMSecsSinceEpoch() - created > PlanCache::MaxAgeMsecs) {
+        file.remove();
+        return false;
+    }
+    return true;
+}
+
+// Changes when an application is updated, or a .desktop file edited
+static QString stamp(const QString &path)
+{
+    if (path.isEmpty())
+        return QString();
+    return QString::number(QFileInfo(path).lastModified().toMSecsSinceEpoch());
+}
+
+void PlanCache::storePlan(const QStringList &request, const LaunchPlan &plan)
+{
+    if (request.isEmpty() || !plan.isValid())
+        return;
+    QStringList fields = { plan.executable, stamp(plan.executable), plan.bundle,
+                           stamp(plan.bundle) };
+    fields.append(plan.arguments);
+    store(entryPath("launch", request), fields);
+}
+
+bool PlanCache::findPlan(const QStringList &request, LaunchPlan *plan)
+{
+    QStringList fields;
+    if (request.isEmpty() || !find(entryPath("launch", request), &fields) || fields.size() < 4)
+        return false;
+    if (stamp(fields[0]) != fields[1] || stamp(fields[2]) != fields[3])
+        return false;
+    plan->executable = fields[0];
+    plan->bundle = fields[2];
+    plan->arguments = fields.mid(4);
+    qDebug() << "# Using the plan prepared for" << request;
+    return true;
+}
+
+void PlanCache::storeApplication(const QString &document, const QString &application,
+                                 const QString &rewrittenDocument)
+{
+    if (application.isEmpty())
+        return;
+    store(entryPath("open", { document }),
+          { application, stamp(application), rewrittenDocument });
+}
+
+bool PlanCache::findApplication(const QString &document, QString *application,
+                                QString *rewrittenDocument)
+{
+    QStringList fields;
+    if (!find(entryPath("open", { document }), &fields) || fields.size() != 3)
+        return false;
+    if (stamp(fields[0]) != fields[1])
+        return false;
+    *application = fields[0];
+    *rewrittenDocument = fields[2];
+    qDebug() << "# Using the application prepared for" << document;
+    return true;
+}
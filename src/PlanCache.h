@@ -0,0 +1,44 @@
+#ifndef PLANCACHE_H
+#define PLANCACHE_H
+
+#include <QString>
+#include <QStringList>
+
+#include "LaunchPlan.h"
+
+/**
+ * @file PlanCache.h
+ * @class PlanCache
+ * @brief Resolutions done ahead of time by 'launch --prepare' and 'open --prepare'.
+ *
+ * Menu and Filer know what the user is likely to launch before the click, e.g.,
+ * on hover or when an item is selected. They can have it resolved then, so that
+ * the actual launch or open only has to spawn the process. Entries are files in
+ * $XDG_RUNTIME_DIR/launch/plans/, keyed by the request and the working directory,
+ * and are used for MaxAgeMsecs; a plan is also dropped when its executable has
+ * been modified since, and so is an application for a document.
+ */
+class PlanCache
+{
+public:
+    /**
+     * @param request The arguments of 'launch', starting with the application.
+     */
+    static void storePlan(const QStringList &request, const LaunchPlan &plan);
+    static bool findPlan(const QStringList &request, LaunchPlan *plan);
+
+    /**
+     * @param document As given to 'open'.
+     * @param rewrittenDocument As rewritten by Launcher::applicationForDocument().
+     */
+    static void storeApplication(const QString &document, const QString &application,
+                                 const QString &rewrittenDocument);
+    static bool findApplication(const QString &document, QString *application,
+                                QString *rewrittenDocument);
+
+    static QString directory();
+
+    static const int MaxAgeMsecs = 30 * 1000;
+};
+
+#endif // PLANCACHE_H
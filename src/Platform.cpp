@@ -0,0 +1,110 @@
+#include "Platform.h"
+
+#include <QFile>
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__FreeBSD__)
+#  include <sys/param.h>
+#  include <sys/sysctl.h>
+#  include <sys/user.h>
+#endif
+
+bool Platform::makeExecutable(const QString &path)
+{
+    const QByteArray encoded = QFile::encodeName(path);
+    struct stat st;
+    if (stat(encoded.constData(), &st) != 0)
+        return false;
+    mode_t mode = st.st_mode & 07777;
+    if (mode & S_IRUSR)
+        mode |= S_IXUSR;
+    if (mode & S_IRGRP)
+        mode |= S_IXGRP;
+    if (mode & S_IROTH)
+        mode |= S_IXOTH;
+    return fchmodat(AT_FDCWD, encoded.constData(), mode, 0) == 0;
+}
+
+bool Platform::touch(const QString &path)
+{
+    return utimensat(AT_FDCWD, QFile::encodeName(path).constData(), nullptr, 0) == 0;
+}
+
+uid_t Platform::processOwner(qint64 pid)
+{
+    if (pid <= 0)
+        return uid_t(-1);
+#if defined(__FreeBSD__)
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, int(pid) };
+    struct kinfo_proc info;
+    size_t length = sizeof(info);
+    if (sysctl(mib, 4, &info, &length, nullptr, 0) != 0 || length != sizeof(info))
+        return uid_t(-1);
+    return info.ki_uid;
+#else
+    // "Uid:" lists the real, effective, saved and file system user IDs
+    QFile status(QString("/proc/%1/status").arg(pid));
+    if (!status.open(QIODevice::ReadOnly))
+        return uid_t(-1);
+    for (const QByteArray &line : status.readAll().split('\n')) {
+        if (!line.startsWith("Uid:"))
+            continue;
+        const QList<QByteArray> ids = line.mid(4).simplified().split(' ');
+        bool ok = false;
+        uint uid = ids.value(1).toUInt(&ok);
+        return ok ? uid_t(uid) : uid_t(-1);
+    }
+    return uid_t(-1);
+#endif
+}
+
+quint64 Platform::processStartTime(qint64 pid)
+{
+    if (pid <= 0)
+        return 0;
+#if defined(__FreeBSD__)
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PID, int(pid) };
+    struct kinfo_proc info;
+    size_t length = sizeof(info);
+    if (sysctl(mib, 4, &info, &length, nullptr, 0) != 0 || length != sizeof(info))
+        return 0;
+    return quint64(info.ki_start.tv_sec) * 1000000 + quint64(info.ki_start.tv_usec);
+#else
+    // Field 22 is the start time in clock ticks since boot; the command name
+    // in field 2 may contain spaces and parentheses, so count from its end
+    QFile stat(QString("/proc/%1/stat").arg(pid));
+    if (!stat.open(QIODevice::ReadOnly))
+        return 0;
+    const QByteArray data = stat.readAll();
+    const int commandEnd = data.lastIndexOf(')');
+    if (commandEnd < 0)
+        return 0;
+    const QList<QByteArray> fields = data.mid(commandEnd + 2).split(' ');
+    return fields.value(19).toULongLong();
+#endif
+}
+
+QString Platform::processExecutable(qint64 pid)
+{
+    if (pid <= 0)
+        return QString();
+#if defined(__FreeBSD__)
+    // Works without procfs, which is not mounted by default
+    int mib[4] = { CTL_KERN, KERN_PROC, KERN_PROC_PATHNAME, int(pid) };
+    char path[PATH_MAX];
+    size_t pathLength = sizeof(path);
+    if (sysctl(mib, 4, path, &pathLength, nullptr, 0) == 0 && pathLength > 1)
+        return QFile::decodeName(QByteArray(path, int(pathLength) - 1));
+    const QByteArray link = QString("/proc/%1/file").arg(pid).toUtf8();
+#else
+    const QByteArray link = QString("/proc/%1/exe").arg(pid).toUtf8();
+#endif
+    char buffer[PATH_MAX];
+    ssize_t length = readlink(link.constData(), buffer, sizeof(buffer));
+    if (length <= 0 || length == ssize_t(sizeof(buffer)))
+        return QString();
+    return QFile::decodeName(QByteArray(buffer, int(length)));
+}
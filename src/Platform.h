@@ -0,0 +1,47 @@
+#ifndef PLATFORM_H
+#define PLATFORM_H
+
+#include <QString>
+
+#include <sys/types.h>
+
+/**
+ * @file Platform.h
+ * @class Platform
+ * @brief System calls for what would otherwise need chmod, touch, ps or readlink.
+ *
+ * Running such a tool costs a fork and an exec, which is far more than the
+ * operation itself. Implemented for Linux and FreeBSD.
+ */
+class Platform
+{
+public:
+    /**
+     * Like 'chmod +x': adds the execute permission for everyone who may read path.
+     */
+    static bool makeExecutable(const QString &path);
+
+    /**
+     * Like 'touch' on an existing file or directory: sets its times to now.
+     */
+    static bool touch(const QString &path);
+
+    /**
+     * @return The effective user ID of the process, or -1 if it does not exist.
+     */
+    static uid_t processOwner(qint64 pid);
+
+    /**
+     * @return When the process was started, in an unspecified unit that only
+     *         compares with other values of the same process ID, or 0 if it
+     *         does not exist. Tells a process from a later one with a reused ID.
+     */
+    static quint64 processStartTime(qint64 pid);
+
+    /**
+     * @return The path of the executable the process is running, or an empty string.
+     */
+    static QString processExecutable(qint64 pid);
+};
+
+#endif // PLATFORM_H
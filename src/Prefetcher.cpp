@@ -0,0 +1,330 @@
+#include "Prefetcher.h"
+
+#include <QCryptographicHash>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__FreeBSD__)
+#  include <sys/types.h>
+#  include <sys/user.h>
+#  include <libutil.h>
+#endif
+
+#include <algorithm>
+#include <map>
+#include <thread>
+#include <utility>
+#include <vector>
+
+static const char HistoryMagic[] = "launch-prefetch 1";
+
+// Do not read ahead more than this per launch, so that a huge application
+// can't push everything else out of the page cache
+static const qint64 MaxPrefetchBytes = 512 * 1024 * 1024;
+
+// Record at most this much of one file, so that a large file the application
+// only touches here and there can't take up most of MaxPrefetchBytes
+static const qint64 MaxRecordedBytesPerFile = 32 * 1024 * 1024;
+
+// Ranges closer than this are merged, since reading the gap is cheaper than a seek
+static const qint64 MergeGapBytes = 256 * 1024;
+
+typedef std::vector<std::pair<qint64, qint64>> Ranges; // Offset, length
+
+bool Prefetcher::isEnabled()
+{
+    return qgetenv("LAUNCH_PREFETCH") != "0";
+}
+
+QString Prefetcher::historyPath(const QString &key)
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + "/launch/prefetch/"
+            + QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+}
+
+static void readAhead(int fd, qint64 offset, qint64 length)
+{
+#if defined(__linux__)
+    if (readahead(fd, offset, size_t(length)) == 0)
+        return;
+#endif
+    posix_fadvise(fd, offset, length, POSIX_FADV_WILLNEED);
+}
+
+struct HistoryEntry
+{
+    QByteArray path;
+    qint64 size;
+    qint64 modified;
+    Ranges ranges;
+};
+
+// The entries of a history, with the ranges cut to MaxPrefetchBytes in total
+static std::vector<HistoryEntry> parseHistory(const QByteArray &history)
+{
+    std::vector<HistoryEntry> entries;
+    const QList<QByteArray> lines = history.split('\n');
+    if (lines.isEmpty() || !lines.first().startsWith(HistoryMagic))
+        return entries;
+    qint64 total = 0;
+    for (int i = 1; i < lines.size() && total < MaxPrefetchBytes; i++) {
+        // path<TAB>size<TAB>mtime<TAB>offset+length,offset+length,...
+        const QList<QByteArray> fields = lines[i].split('\t');
+        if (fields.size() != 4)
+            continue;
+        HistoryEntry entry = { fields[0], fields[1].toLongLong(), fields[2].toLongLong(), {} };
+        for (const QByteArray &range : fields[3].split(',')) {
+            const int plus = range.indexOf('+');
+            if (plus <= 0)
+                continue;
+            const qint64 offset = range.left(plus).toLongLong();
+            const qint64 length = qMin(range.mid(plus + 1).toLongLong(), MaxPrefetchBytes - total);
+            if (length <= 0)
+                break;
+            entry.ranges.emplace_back(offset, length);
+            total += length;
+        }
+        if (!entry.ranges.empty())
+            entries.push_back(entry);
+    }
+    return entries;
+}
+
+// Only makes system calls, so that it can run in a child forked by a process
+// with threads
+static void readAheadEntries(const std::vector<HistoryEntry> &entries)
+{
+    for (const HistoryEntry &entry : entries) {
+        int fd = open(entry.path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size != entry.size
+            || qint64(st.st_mtime) != entry.modified) {
+            close(fd); // Changed since; what was hot may be elsewhere now
+            continue;
+        }
+        for (const auto &range : entry.ranges)
+            readAhead(fd, range.first, range.second);
+        close(fd);
+    }
+}
+
+static qint64 totalBytes(const std::vector<HistoryEntry> &entries)
+{
+    qint64 total = 0;
+    for (const HistoryEntry &entry : entries) {
+        for (const auto &range : entry.ranges)
+            total += range.second;
+    }
+    return total;
+}
+
+static QByteArray readHistory(const QString &key)
+{
+    QFile file(Prefetcher::historyPath(key));
+    if (!file.open(QIODevice::ReadOnly))
+        return QByteArray();
+    return file.readAll();
+}
+
+void Prefetcher::prefetch(const QString &key)
+{
+    if (key.isEmpty() || !isEnabled())
+        return;
+    QByteArray history = readHistory(key);
+    if (history.isEmpty())
+        return;
+    // readahead() blocks until the reads have been queued, which can take a
+    // while for many files; the application is started meanwhile
+    std::thread([history]() {
+        const std::vector<HistoryEntry> entries = parseHistory(history);
+        readAheadEntries(entries);
+        qDebug() << "# Prefetching" << totalBytes(entries) / 1024 << "KiB of"
+                 << entries.size() << "files";
+    }).detach();
+}
+
+void Prefetcher::prefetchNow(const QString &key)
+{
+    if (key.isEmpty() || !isEnabled())
+        return;
+    const std::vector<HistoryEntry> entries = parseHistory(readHistory(key));
+    if (entries.empty())
+        return;
+    // A thread would not survive the execve() that follows, so queue the reads
+    // in a process of their own. It is forked twice, so that it is not left as
+    // a zombie child of the application
+    pid_t helper = fork();
+    if (helper == 0) {
+        if (fork() == 0) {
+            readAheadEntries(entries);
+            _exit(0);
+        }
+        _exit(0);
+    }
+    if (helper > 0) {
+        while (waitpid(helper, nullptr, 0) < 0 && errno == EINTR) {
+        }
+        qDebug() << "# Prefetching" << totalBytes(entries) / 1024 << "KiB of"
+                 << entries.size() << "files in the background";
+    }
+}
+
+void Prefetcher::prefetchFile(const QString &path)
+{
+    if (!isEnabled())
+        return;
+    int fd = open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+        return;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode))
+        readAhead(fd, 0, qMin(qint64(st.st_size), MaxPrefetchBytes));
+    close(fd);
+}
+
+// The regular files pid has mapped, by path
+static std::vector<QByteArray> mappedFiles(qint64 pid)
+{
+    std::vector<QByteArray> paths;
+#if defined(__FreeBSD__)
+    int count = 0;
+    struct kinfo_vmentry *entries = kinfo_getvmmap(pid_t(pid), &count);
+    if (entries == nullptr)
+        return paths;
+    for (int i = 0; i < count; i++) {
+        if (entries[i].kve_type == KVME_TYPE_VNODE && entries[i].kve_path[0] == '/')
+            paths.push_back(QByteArray(entries[i].kve_path));
+    }
+    free(entries);
+#else
+    // address perms offset dev inode path
+    QFile maps(QString("/proc/%1/maps").arg(pid));
+    if (!maps.open(QIODevice::ReadOnly))
+        return paths;
+    for (const QByteArray &line : maps.readAll().split('\n')) {
+        const int slash = line.indexOf('/');
+        if (slash < 0 || line.endsWith(" (deleted)"))
+            continue;
+        paths.push_back(line.mid(slash));
+    }
+#endif
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+    return paths;
+}
+
+// The parts of the file that are in the page cache, according to mincore()
+static Ranges residentRanges(int fd, qint64 size)
+{
+    Ranges ranges;
+    if (size <= 0)
+        return ranges;
+    void *map = mmap(nullptr, size_t(size), PROT_READ, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED)
+        return ranges;
+    const qint64 pageSize = sysconf(_SC_PAGESIZE);
+    const size_t pages = size_t((size + pageSize - 1) / pageSize);
+#if defined(__linux__)
+    std::vector<unsigned char> resident(pages);
+#else
+    std::vector<char> resident(pages);
+#endif
+    if (mincore(map, size_t(size), resident.data()) == 0) {
+        for (size_t page = 0; page < pages; page++) {
+            if (!(resident[page] & 1))
+                continue;
+            const qint64 offset = qint64(page) * pageSize;
+            if (!ranges.empty()
+                && offset - (ranges.back().first + ranges.back().second) <= MergeGapBytes) {
+                ranges.back().second = offset + pageSize - ranges.back().first;
+            } else {
+                ranges.emplace_back(offset, pageSize);
+            }
+        }
+        if (!ranges.empty())
+            ranges.back().second = qMin(ranges.back().second, size - ranges.back().first);
+    }
+    munmap(map, size_t(size));
+    return ranges;
+}
+
+// Data that most running applications map, such as the locale archive and
+// fonts; it is in the page cache anyway and would only fill the history
+static bool isSharedSystemFile(const QByteArray &path)
+{
+    static const char *const prefixes[] = {
+        "/usr/lib/locale/",   "/usr/share/locale/",    "/usr/share/fonts/",
+        "/usr/local/share/fonts/", "/var/cache/fontconfig/", "/usr/share/icons/",
+        "/usr/local/share/icons/", "/usr/share/mime/",     "/usr/local/share/mime/",
+    };
+    for (const char *prefix : prefixes) {
+        if (path.startsWith(prefix))
+            return true;
+    }
+    return path.contains("/gconv/") || path.endsWith("/locale-archive");
+}
+
+void Prefetcher::record(const QString &key, qint64 pid)
+{
+    if (key.isEmpty() || !isEnabled())
+        return;
+    QByteArray history = QByteArray(HistoryMagic) + '\n';
+    qint64 total = 0;
+    for (const QByteArray &path : mappedFiles(pid)) {
+        if (isSharedSystemFile(path))
+            continue;
+        int fd = open(path.constData(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0)
+            continue;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+            close(fd);
+            continue;
+        }
+        Ranges ranges = residentRanges(fd, st.st_size);
+        close(fd);
+        qint64 recorded = 0;
+        for (size_t i = 0; i < ranges.size(); i++) {
+            if (recorded >= MaxRecordedBytesPerFile) {
+                ranges.resize(i);
+                break;
+            }
+            ranges[i].second = qMin(ranges[i].second, MaxRecordedBytesPerFile - recorded);
+            recorded += ranges[i].second;
+        }
+        if (ranges.empty())
+            continue;
+        history += path + '\t' + QByteArray::number(qint64(st.st_size)) + '\t'
+                + QByteArray::number(qint64(st.st_mtime)) + '\t';
+        for (size_t i = 0; i < ranges.size(); i++) {
+            if (i > 0)
+                history += ',';
+            history += QByteArray::number(ranges[i].first) + '+'
+                    + QByteArray::number(ranges[i].second);
+            total += ranges[i].second;
+        }
+        history += '\n';
+    }
+
+    const QString path = historyPath(key);
+    QDir().mkpath(QFileInfo(path).path());
+    QSaveFile file(path);
+    if (file.open(QIODevice::WriteOnly)) {
+        file.write(history);
+        if (file.commit())
+            qDebug() << "# Recorded" << total / 1024 << "KiB to prefetch for" << key;
+    }
+}
@@ -0,0 +1,56 @@
+#ifndef PREFETCHER_H
+#define PREFETCHER_H
+
+#include <QString>
+
+/**
+ * @file Prefetcher.h
+ * @class Prefetcher
+ * @brief Reads the files an application needs into the page cache before it asks for them.
+ *
+ * Cold starts of large applications are dominated by page faults on the
+ * executable and its shared libraries, each one waiting for the disk. After
+ * an application has been running for the error window, the launcher records
+ * which parts of its mapped files are in the page cache, up to 32 MiB per file
+ * and leaving out data that all applications share, such as fonts and the
+ * locale archive. When it is launched again, those parts are read ahead with
+ * posix_fadvise(POSIX_FADV_WILLNEED) (readahead() on Linux) while the process
+ * is being started, so the disk reads them in large requests rather than in
+ * one fault at a time.
+ *
+ * The history is kept per bundle (or executable) in ~/.cache/launch/prefetch/,
+ * one line per file with its size, modification time and ranges. Files that
+ * have changed since are skipped. Set LAUNCH_PREFETCH=0 to turn this off.
+ */
+class Prefetcher
+{
+public:
+    /**
+     * Read ahead what key has used last time, in a background thread.
+     */
+    static void prefetch(const QString &key);
+
+    /**
+     * Like prefetch(), but the reads are queued by a helper process that
+     * outlives this one; for when this process is about to execute the
+     * application itself. Costs a fork() of this process.
+     */
+    static void prefetchNow(const QString &key);
+
+    /**
+     * Read ahead all of path, e.g., an executable that has no history yet.
+     */
+    static void prefetchFile(const QString &path);
+
+    /**
+     * Record the resident parts of the files that pid has mapped, as the
+     * history of key.
+     */
+    static void record(const QString &key, qint64 pid);
+
+    static QString historyPath(const QString &key);
+
+    static bool isEnabled();
+};
+
+#endif // PREFETCHER_H
@@ -0,0 +1,119 @@
+#include "RunningRegistry.h"
+#include "Platform.h"
+
+#include <QCryptographicHash>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+
+QString RunningRegistry::directory()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+            + "/launch/running";
+}
+
+static QString entryPath(qint64 pid)
+{
+    return RunningRegistry::directory() + "/" + QString::number(pid);
+}
+
+void RunningRegistry::add(const QString &bundle, qint64 pid)
+{
+    if (bundle.isEmpty() || pid <= 0)
+        return;
+    const quint64 startTime = Platform::processStartTime(pid);
+    if (startTime == 0)
+        return; // Already gone
+    const uid_t uid = Platform::processOwner(pid);
+
+    QDir().mkpath(directory());
+    QSaveFile file(entryPath(pid));
+    if (!file.open(QIODevice::WriteOnly))
+        return;
+    file.write(bundle.toUtf8() + '\n' + QByteArray::number(startTime) + '\n'
+               + QByteArray::number(qulonglong(uid)) + '\n');
+    if (file.commit())
+        qDebug() << "# Registered" << pid << "as running" << bundle;
+}
+
+void RunningRegistry::remove(qint64 pid)
+{
+    QFile::remove(entryPath(pid));
+}
+
+QList<RunningRegistry::Instance> RunningRegistry::instances(const QString &bundle)
+{
+    QList<Instance> result;
+    const QByteArray wanted = bundle.toUtf8();
+    QDir dir(directory());
+    for (const QString &name : dir.entryList(QDir::Files)) {
+        bool ok = false;
+        const qint64 pid = name.toLongLong(&ok);
+        if (!ok)
+            continue; // Not ours, e.g., a temporary file of QSaveFile
+        QFile file(dir.filePath(name));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+        const QList<QByteArray> lines = file.readAll().split('\n');
+        file.close();
+
+        Instance instance;
+        instance.pid = pid;
+        instance.startTime = lines.value(1).toULongLong();
+        instance.uid = uid_t(lines.value(2).toULongLong());
+        instance.registeredMsecs = QFileInfo(file).lastModified().toMSecsSinceEpoch();
+        // Reap entries of processes that have exited, even for other bundles
+        if (instance.startTime == 0 || Platform::processStartTime(pid) != instance.startTime) {
+            qDebug() << "# Removing stale entry for" << pid << "from the running registry";
+            file.remove();
+            continue;
+        }
+        if (lines.value(0) == wanted && instance.uid == geteuid())
+            result.append(instance);
+    }
+    return result;
+}
+
+bool RunningRegistry::StartLock::acquire(const QString &bundle, int timeoutMsecs)
+{
+    release();
+    // One lock file per bundle, named by a hash since bundle paths may be long
+    const QString lockDirectory = directory() + "/locks";
+    QDir().mkpath(lockDirectory);
+    const QString path = lockDirectory + "/"
+            + QCryptographicHash::hash(bundle.toUtf8(), QCryptographicHash::Sha1).toHex();
+    m_fd = open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if (m_fd < 0)
+        return false;
+
+    // flock() can't time out, so poll; the lock is rarely contended
+    QElapsedTimer clock;
+    clock.start();
+    while (flock(m_fd, LOCK_EX | LOCK_NB) != 0) {
+        if ((errno != EWOULDBLOCK && errno != EINTR) || clock.elapsed() >= timeoutMsecs) {
+            release();
+            return false;
+        }
+        usleep(10 * 1000);
+    }
+    return true;
+}
+
+void RunningRegistry::StartLock::release()
+{
+    // Closing releases the lock; so does exiting or executing another program
+    if (m_fd >= 0) {
+        close(m_fd);
+        m_fd = -1;
+    }
+}
@@ -0,0 +1,75 @@
+#ifndef RUNNINGREGISTRY_H
+#define RUNNINGREGISTRY_H
+
+#include <QList>
+#include <QString>
+
+#include <sys/types.h>
+
+/**
+ * @file RunningRegistry.h
+ * @class RunningRegistry
+ * @brief Which processes have been started for a bundle, and by whom.
+ *
+ * Whoever starts a bundle (launch, launch --supervise, launch-service) adds
+ * its process here, so that finding out whether a bundle is already running
+ * does not need to go through all windows and the environment of their
+ * processes. Each instance is a file in $XDG_RUNTIME_DIR/launch/running/
+ * named by the process ID, holding the bundle, the start time of the process
+ * and its user ID. An entry whose process has exited, or whose process ID now
+ * belongs to a process that was started later, is removed when it is found.
+ *
+ * While a bundle is being started, the starting process holds a StartLock for
+ * it, so that a second request for the same bundle waits for the first one and
+ * then finds its instance instead of starting another one.
+ */
+class RunningRegistry
+{
+public:
+    struct Instance
+    {
+        qint64 pid = 0;
+        quint64 startTime = 0;
+        uid_t uid = uid_t(-1);
+        qint64 registeredMsecs = 0; /**< When it was added, in milliseconds since the epoch. */
+    };
+
+    class StartLock
+    {
+    public:
+        StartLock() = default;
+        ~StartLock() { release(); }
+        StartLock(const StartLock &) = delete;
+        StartLock &operator=(const StartLock &) = delete;
+
+        /**
+         * Waits for up to timeoutMsecs for other processes starting bundle.
+         *
+         * @return False if the lock could not be taken in time.
+         */
+        bool acquire(const QString &bundle, int timeoutMsecs);
+        void release();
+
+    private:
+        int m_fd = -1;
+    };
+
+    /**
+     * Record that pid runs bundle. Does nothing for an empty bundle.
+     */
+    static void add(const QString &bundle, qint64 pid);
+
+    /**
+     * Forget pid, e.g., when it has been seen to exit.
+     */
+    static void remove(qint64 pid);
+
+    /**
+     * @return The live instances of bundle that run as the current user.
+     */
+    static QList<Instance> instances(const QString &bundle);
+
+    static QString directory();
+};
+
+#endif // RUNNINGREGISTRY_H
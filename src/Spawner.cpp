@@ -0,0 +1,507 @@
+#include "Spawner.h"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#if defined(__FreeBSD__)
+#  include <sys/event.h>
+#else
+#  include <sys/syscall.h>
+#  ifndef SYS_pidfd_open
+#    define SYS_pidfd_open 434
+#  endif
+#endif
+
+Spawner::Spawner()
+    : m_environment(QProcessEnvironment::systemEnvironment()),
+      m_stdinFd(-1),
+      m_stdoutFd(-1),
+      m_inheritedFd(-1),
+      m_captureStandardError(false),
+      m_forwardStandardError(false),
+      m_pid(-1),
+      m_stderrFd(-1),
+      m_exitFd(-1),
+      m_exitCode(0),
+      m_running(false),
+      m_error(0)
+{
+}
+
+Spawner::~Spawner()
+{
+    // Like a detached process, the child keeps running if we go away first
+    if (m_stderrFd >= 0)
+        close(m_stderrFd);
+    if (m_exitFd >= 0)
+        close(m_exitFd);
+}
+
+void Spawner::setProgram(const QString &program)
+{
+    m_program = program;
+}
+
+QString Spawner::program() const
+{
+    return m_program;
+}
+
+void Spawner::setArguments(const QStringList &arguments)
+{
+    m_arguments = arguments;
+}
+
+void Spawner::setProcessEnvironment(const QProcessEnvironment &environment)
+{
+    m_environment = environment;
+}
+
+void Spawner::setWorkingDirectory(const QString &directory)
+{
+    m_workingDirectory = directory;
+}
+
+void Spawner::setPolicy(const LaunchPolicy &policy)
+{
+    m_policy = policy;
+}
+
+void Spawner::setStandardInputOutputFds(int stdinFd, int stdoutFd)
+{
+    m_stdinFd = stdinFd;
+    m_stdoutFd = stdoutFd;
+}
+
+void Spawner::setInheritedFd(int fd)
+{
+    m_inheritedFd = fd;
+}
+
+void Spawner::setCaptureStandardError(bool capture)
+{
+    m_captureStandardError = capture;
+}
+
+void Spawner::setFatalErrorMatcher(const std::function<bool(const QByteArray &line)> &matcher)
+{
+    m_standardError.setFatalLineMatcher(matcher);
+}
+
+bool Spawner::hasFatalError() const
+{
+    return m_standardError.hasFatalLine();
+}
+
+void Spawner::setForwardStandardError(bool forward, int fd)
+{
+    m_forwardStandardError = forward;
+    m_log.setForwardFd(fd);
+    if (forward && !m_standardError.isEmpty()) {
+        const QByteArray kept = m_standardError.contents();
+        m_log.forward(kept.constData(), size_t(kept.size()));
+        m_log.write(kept.constData(), kept.size());
+        m_standardError.clear();
+    }
+}
+
+bool Spawner::setLogStandardError(const QString &name)
+{
+    if (m_stderrFd < 0 || !m_log.open(name, m_pid))
+        return false;
+    qDebug() << "# Logging stderr to" << m_log.path();
+    return true;
+}
+
+// Convert program, arguments and environment into what execve() needs;
+// the pointers point into storage
+void Spawner::prepare(std::vector<QByteArray> &storage, std::vector<char *> &argv,
+                      std::vector<char *> &envp) const
+{
+    const QStringList environment = m_environment.toStringList();
+    storage.reserve(1 + m_arguments.size() + environment.size());
+    storage.push_back(QFile::encodeName(m_program));
+    argv.push_back(storage.back().data());
+    for (const QString &argument : m_arguments) {
+        storage.push_back(argument.toLocal8Bit());
+        argv.push_back(storage.back().data());
+    }
+    argv.push_back(nullptr);
+    for (const QString &variable : environment) {
+        storage.push_back(variable.toLocal8Bit());
+        envp.push_back(storage.back().data());
+    }
+    envp.push_back(nullptr);
+}
+
+// Block all signals of the calling thread and return the previous mask in saved.
+// A handler of ours that ran in a vfork() child would run on our memory and
+// stack, so signals stay blocked from before vfork() until the child has reset
+// its handlers
+static void blockSignals(sigset_t *saved)
+{
+    sigset_t all;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, saved);
+}
+
+static void restoreSignals(const sigset_t *saved)
+{
+    pthread_sigmask(SIG_SETMASK, saved, nullptr);
+}
+
+// Reset all handlers, then unblock all signals. Caught signals are reset by
+// execve() only, and ignored signals and the signal mask survive it; the
+// supervisor, for one, ignores SIGPIPE, which the application must not inherit.
+// Only makes system calls, so that it can be called between vfork() and execve()
+static void resetSignals()
+{
+    for (int sig = 1; sig < NSIG; sig++) {
+        struct sigaction action;
+        if (sigaction(sig, nullptr, &action) == 0 && action.sa_handler != SIG_DFL) {
+            action.sa_handler = SIG_DFL;
+            action.sa_flags &= ~SA_SIGINFO;
+            sigaction(sig, &action, nullptr);
+        }
+    }
+    sigset_t empty;
+    sigemptyset(&empty);
+    sigprocmask(SIG_SETMASK, &empty, nullptr);
+}
+
+bool Spawner::execInPlace()
+{
+    std::vector<QByteArray> storage;
+    std::vector<char *> argv, envp;
+    prepare(storage, argv, envp);
+    m_policy.apply();
+    if (m_workingDirectory.isEmpty()
+        || chdir(QFile::encodeName(m_workingDirectory).constData()) == 0)
+        execve(argv[0], argv.data(), envp.data());
+    m_error = errno;
+    m_errorString = QString::fromLocal8Bit(strerror(errno));
+    qDebug() << "# Could not execute" << m_program << m_errorString;
+    return false;
+}
+
+int Spawner::execChild(char *const *argv, char *const *envp, const char *workingDirectory,
+                       int stderrFd) const
+{
+    // dup2() clears close-on-exec on the new descriptor
+    if (m_stdinFd >= 0 && m_stdinFd != STDIN_FILENO)
+        dup2(m_stdinFd, STDIN_FILENO);
+    if (m_stdoutFd >= 0 && m_stdoutFd != STDOUT_FILENO)
+        dup2(m_stdoutFd, STDOUT_FILENO);
+    if (stderrFd >= 0)
+        dup2(stderrFd, STDERR_FILENO);
+    // The child has a copy of our file descriptor table, so this is only for it
+    if (m_inheritedFd >= 0)
+        fcntl(m_inheritedFd, F_SETFD, 0);
+    resetSignals();
+    m_policy.apply();
+    if (*workingDirectory == '\0' || chdir(workingDirectory) == 0)
+        execve(argv[0], argv, envp);
+    return errno;
+}
+
+bool Spawner::startDetached()
+{
+    std::vector<QByteArray> storage;
+    std::vector<char *> argv, envp;
+    prepare(storage, argv, envp);
+    const QByteArray workingDirectory = QFile::encodeName(m_workingDirectory);
+
+    int statusPipe[2];
+    if (pipe2(statusPipe, O_CLOEXEC) != 0) {
+        m_error = errno;
+        m_errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+
+    // The intermediate process exits right away, so the application is not
+    // our child and nobody has to reap it. It has to be a real fork(), since a
+    // vfork() child may not vfork() again. It keeps all signals blocked, and
+    // only the application resets and unblocks them
+    sigset_t savedSignals;
+    blockSignals(&savedSignals);
+    pid_t intermediate = fork();
+    if (intermediate == 0) {
+        // Like QProcess::startDetached(), leave our session and its terminal
+        setsid();
+        volatile int error = 0;
+        pid_t pid = vfork();
+        if (pid == 0) {
+            // Shares the memory of the intermediate process until execve()
+            error = execChild(argv.data(), envp.data(), workingDirectory.constData(), -1);
+            _exit(127);
+        }
+        int status[2] = { int(pid), pid < 0 ? errno : error };
+        (void)!write(statusPipe[1], status, sizeof(status));
+        _exit(0);
+    }
+    const int forkError = errno;
+    restoreSignals(&savedSignals);
+    close(statusPipe[1]);
+    if (intermediate < 0) {
+        m_error = forkError;
+        m_errorString = QString::fromLocal8Bit(strerror(m_error));
+        close(statusPipe[0]);
+        return false;
+    }
+
+    int status[2] = { -1, EIO };
+    ssize_t n;
+    do {
+        n = read(statusPipe[0], status, sizeof(status));
+    } while (n < 0 && errno == EINTR);
+    close(statusPipe[0]);
+    while (waitpid(intermediate, nullptr, 0) < 0 && errno == EINTR) {
+    }
+
+    if (n != sizeof(status) || status[0] < 0 || status[1] != 0) {
+        m_error = (n == sizeof(status) && status[1] != 0) ? status[1] : EIO;
+        m_errorString = QString::fromLocal8Bit(strerror(m_error));
+        qDebug() << "# Could not execute" << m_program << m_errorString;
+        return false;
+    }
+    m_pid = status[0];
+    return true;
+}
+
+bool Spawner::start()
+{
+    // Everything the child needs is prepared here, since after vfork() it
+    // may only call async-signal-safe functions
+    std::vector<QByteArray> storage;
+    std::vector<char *> argv, envp;
+    prepare(storage, argv, envp);
+    const QByteArray workingDirectory = QFile::encodeName(m_workingDirectory);
+
+    int statusPipe[2];
+    if (pipe2(statusPipe, O_CLOEXEC) != 0) {
+        m_error = errno;
+        m_errorString = QString::fromLocal8Bit(strerror(errno));
+        return false;
+    }
+    int stderrPipe[2] = { -1, -1 };
+    if (m_captureStandardError && pipe2(stderrPipe, O_CLOEXEC) != 0) {
+        m_error = errno;
+        m_errorString = QString::fromLocal8Bit(strerror(errno));
+        close(statusPipe[0]);
+        close(statusPipe[1]);
+        return false;
+    }
+
+    sigset_t savedSignals;
+    blockSignals(&savedSignals);
+    pid_t pid = vfork();
+    if (pid == 0) {
+        int error = execChild(argv.data(), envp.data(), workingDirectory.constData(),
+                              stderrPipe[1]);
+        (void)!write(statusPipe[1], &error, sizeof(error));
+        _exit(127);
+    }
+    const int vforkError = errno;
+    restoreSignals(&savedSignals);
+
+    close(statusPipe[1]);
+    if (stderrPipe[1] >= 0)
+        close(stderrPipe[1]);
+
+    if (pid < 0) {
+        m_error = vforkError;
+        m_errorString = QString::fromLocal8Bit(strerror(m_error));
+        close(statusPipe[0]);
+        if (stderrPipe[0] >= 0)
+            close(stderrPipe[0]);
+        return false;
+    }
+
+    // End of file means that execve() has succeeded and closed the pipe
+    int error = 0;
+    ssize_t n;
+    do {
+        n = read(statusPipe[0], &error, sizeof(error));
+    } while (n < 0 && errno == EINTR);
+    close(statusPipe[0]);
+
+    m_pid = pid;
+    if (n == sizeof(error)) {
+        m_error = error;
+        m_errorString = QString::fromLocal8Bit(strerror(error));
+        qDebug() << "# Could not execute" << m_program << m_errorString;
+        if (stderrPipe[0] >= 0)
+            close(stderrPipe[0]);
+        reap(true);
+        return false;
+    }
+
+    m_running = true;
+    m_stderrFd = stderrPipe[0];
+    if (m_stderrFd >= 0)
+        fcntl(m_stderrFd, F_SETFL, fcntl(m_stderrFd, F_GETFL) | O_NONBLOCK);
+    return true;
+}
+
+pid_t Spawner::pid() const
+{
+    return m_pid;
+}
+
+bool Spawner::isRunning() const
+{
+    return m_running;
+}
+
+void Spawner::readStandardError()
+{
+    if (m_stderrFd < 0)
+        return;
+    // Without an open log, this only forwards, and drops what the forward fd
+    // has no room for rather than blocking
+    if (m_forwardStandardError) {
+        if (!m_log.transfer(m_stderrFd)) {
+            close(m_stderrFd);
+            m_stderrFd = -1;
+        }
+        return;
+    }
+    char buffer[4096];
+    while (true) {
+        ssize_t n = read(m_stderrFd, buffer, sizeof(buffer));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return; // EAGAIN; nothing more for now
+        if (n == 0) {
+            close(m_stderrFd);
+            m_stderrFd = -1;
+            return;
+        }
+        m_standardError.append(buffer, n);
+    }
+}
+
+bool Spawner::reap(bool block)
+{
+    int status;
+    pid_t result;
+    do {
+        result = waitpid(m_pid, &status, block ? 0 : WNOHANG);
+    } while (result < 0 && errno == EINTR);
+    if (result < 0 && errno == ECHILD) {
+        // Reaped by someone else; the exit code is lost
+        m_running = false;
+    } else if (result != m_pid) {
+        return false;
+    } else {
+        m_running = false;
+        m_exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    }
+    if (m_exitFd >= 0) {
+        close(m_exitFd);
+        m_exitFd = -1;
+    }
+    return true;
+}
+
+// Get a file descriptor that becomes readable when the child exits: a pidfd on
+// Linux, a kqueue with the exit of the child on FreeBSD. Stays -1 where neither
+// is available (Linux < 5.3) or the child has already exited
+void Spawner::watchExit()
+{
+    if (m_exitFd >= 0 || !m_running)
+        return;
+#if defined(__FreeBSD__)
+    int kq = kqueue();
+    if (kq < 0)
+        return;
+    struct kevent change;
+    EV_SET(&change, m_pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0, nullptr);
+    if (kevent(kq, &change, 1, nullptr, 0, nullptr) != 0) {
+        close(kq);
+        return;
+    }
+    m_exitFd = kq;
+#else
+    m_exitFd = int(syscall(SYS_pidfd_open, m_pid, 0));
+#endif
+}
+
+bool Spawner::waitForFinished(int msecs)
+{
+    if (!m_running)
+        return true;
+
+    // Only a fatal error seen while waiting this time ends the wait early
+    const bool hadFatalError = m_standardError.hasFatalLine();
+    QElapsedTimer timer;
+    timer.start();
+    watchExit();
+    while (true) {
+        if (reap(false)) {
+            readStandardError();
+            return true;
+        }
+        qint64 remaining = msecs < 0 ? -1 : msecs - timer.elapsed();
+        if ((msecs >= 0 && remaining <= 0) || (!hadFatalError && m_standardError.hasFatalLine()))
+            return false;
+
+        // Nothing left to read and no deadline, so only the exit can end the wait
+        if (m_stderrFd < 0 && msecs < 0) {
+            reap(true);
+            return true;
+        }
+
+        // Sleep until stderr has something or the child has exited; only without
+        // an exit file descriptor check for the exit in short intervals
+        struct pollfd fds[2];
+        nfds_t count = 0;
+        if (m_stderrFd >= 0)
+            fds[count++] = { m_stderrFd, POLLIN, 0 };
+        if (m_exitFd >= 0)
+            fds[count++] = { m_exitFd, POLLIN, 0 };
+        int timeout = int(remaining);
+        if (m_exitFd < 0 && (timeout < 0 || timeout > 50))
+            timeout = 50;
+        if (poll(fds, count, timeout) > 0 && m_stderrFd >= 0 && fds[0].revents != 0)
+            readStandardError();
+    }
+}
+
+QByteArray Spawner::readAllStandardError()
+{
+    readStandardError();
+    QByteArray result = m_standardError.contents();
+    m_standardError.clear();
+    return result;
+}
+
+int Spawner::exitCode() const
+{
+    return m_exitCode;
+}
+
+QString Spawner::errorString() const
+{
+    return m_errorString;
+}
+
+int Spawner::error() const
+{
+    return m_error;
+}
+
+int Spawner::standardErrorFd() const
+{
+    return m_stderrFd;
+}
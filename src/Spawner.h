@@ -0,0 +1,190 @@
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <QByteArray>
+#include <QProcessEnvironment>
+#include <QString>
+#include <QStringList>
+
+#include <sys/types.h>
+
+#include <functional>
+#include <vector>
+
+#include "ErrorLog.h"
+#include "ErrorOutputBuffer.h"
+#include "LaunchPolicy.h"
+
+/**
+ * @file Spawner.h
+ * @class Spawner
+ * @brief Starts a process with vfork() and execve() instead of QProcess.
+ *
+ * QProcess forks the whole address space of the launcher and sets up pipes and
+ * socket notifiers for all channels. Spawner prepares argv and envp up front,
+ * then uses vfork(), so the cost of starting a process does not grow with the
+ * launcher. If execve() fails, the child reports errno through a close-on-exec
+ * status pipe, so start() knows synchronously whether the program is running.
+ *
+ * A LaunchPolicy is applied in the child, so the program runs with it from its
+ * first instruction.
+ *
+ * stdin and stdout are inherited unless other file descriptors are given.
+ * stderr can optionally be captured through a pipe, into an ErrorOutputBuffer of
+ * bounded size.
+ */
+class Spawner
+{
+public:
+    Spawner();
+    ~Spawner();
+
+    void setProgram(const QString &program);
+    QString program() const;
+    void setArguments(const QStringList &arguments);
+    void setProcessEnvironment(const QProcessEnvironment &environment);
+    void setWorkingDirectory(const QString &directory);
+
+    /**
+     * Start the process with the nice level, scheduling and limits of policy.
+     * Settings that cannot be applied are left as they are.
+     */
+    void setPolicy(const LaunchPolicy &policy);
+
+    /**
+     * Use these file descriptors as stdin and stdout of the process instead of ours.
+     */
+    void setStandardInputOutputFds(int stdinFd, int stdoutFd);
+
+    /**
+     * Let the process inherit fd, which may be close-on-exec in our process,
+     * under the same number.
+     */
+    void setInheritedFd(int fd);
+
+    /**
+     * Capture stderr of the process through a pipe instead of inheriting it.
+     */
+    void setCaptureStandardError(bool capture);
+
+    /**
+     * Check each line of captured stderr as it comes in; waitForFinished() returns
+     * early once matcher has returned true, see hasFatalError().
+     */
+    void setFatalErrorMatcher(const std::function<bool(const QByteArray &line)> &matcher);
+
+    /**
+     * @return True if the fatal error matcher has matched a line of captured stderr.
+     */
+    bool hasFatalError() const;
+
+    /**
+     * Start the process.
+     *
+     * @return True if the program has been executed; false if it could not be,
+     *         in which case errorString() tells why.
+     */
+    bool start();
+
+    /**
+     * Start the process so that it is not our child and keeps running on its own,
+     * like QProcess::startDetached(). stderr is inherited; waiting for it and
+     * capturing stderr do not apply. Costs a fork() of our process.
+     *
+     * @return True if the program has been executed; pid() is its process ID.
+     */
+    bool startDetached();
+
+    /**
+     * Replace the current process with the program, keeping the process ID and stdio.
+     * Captured stderr does not apply.
+     *
+     * @return Only returns if the program could not be executed, with false;
+     *         errorString() tells why.
+     */
+    bool execInPlace();
+
+    pid_t pid() const;
+    bool isRunning() const;
+
+    /**
+     * Wait for the process to exit, collecting captured stderr in the meantime.
+     * Also stops waiting as soon as a fatal error is seen on stderr.
+     *
+     * @param msecs Time to wait in milliseconds, or -1 to wait without a timeout.
+     * @return True if the process has exited.
+     */
+    bool waitForFinished(int msecs = 30000);
+
+    /**
+     * Write stderr of the process to our own stderr (or to fd) from now on instead
+     * of collecting it, e.g., once nobody is going to look at it anymore. What fd
+     * has no room for is dropped, so that the process is never held up by it.
+     */
+    void setForwardStandardError(bool forward, int fd = 2);
+
+    /**
+     * Also write forwarded stderr to an ErrorLog for the application name, starting
+     * with what has been collected so far. Call after start() and before
+     * setForwardStandardError().
+     *
+     * @return False if the log could not be opened.
+     */
+    bool setLogStandardError(const QString &name);
+
+    /**
+     * @return The read end of the captured stderr, e.g., to wait for it with poll(),
+     *         or -1 if it is not captured or has been closed.
+     */
+    int standardErrorFd() const;
+
+    /**
+     * Read whatever is available on the captured stderr without blocking.
+     */
+    void readStandardError();
+
+    /**
+     * @return The captured stderr so far; beginning and end only if there was a lot of it.
+     */
+    QByteArray readAllStandardError();
+
+    /**
+     * @return The exit code, or 128 plus the signal number if the process was killed.
+     */
+    int exitCode() const;
+    QString errorString() const;
+    /**
+     * @return The errno of a failed start(), or 0.
+     */
+    int error() const;
+
+private:
+    QString m_program;
+    QStringList m_arguments;
+    QProcessEnvironment m_environment;
+    QString m_workingDirectory;
+    LaunchPolicy m_policy;
+    int m_stdinFd;
+    int m_stdoutFd;
+    int m_inheritedFd;
+    bool m_captureStandardError;
+    bool m_forwardStandardError;
+    pid_t m_pid;
+    int m_stderrFd;
+    int m_exitFd;
+    int m_exitCode;
+    bool m_running;
+    ErrorOutputBuffer m_standardError;
+    ErrorLog m_log;
+    QString m_errorString;
+    int m_error;
+
+    void prepare(std::vector<QByteArray> &storage, std::vector<char *> &argv,
+                 std::vector<char *> &envp) const;
+    bool reap(bool block);
+    int execChild(char *const *argv, char *const *envp, const char *workingDirectory,
+                  int stderrFd) const;
+    void watchExit();
+};
+
+#endif // SPAWNER_H
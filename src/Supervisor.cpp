@@ -0,0 +1,388 @@
+#include "Supervisor.h"
+#include "PackageIndex.h"
+#include "Prefetcher.h"
+#include "RunningRegistry.h"
+#include "Spawner.h"
+#include "ZygoteProtocol.h"
+#include "launcher.h"
+
+#include <QDebug>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+
+#if defined(__FreeBSD__)
+#  include <sys/event.h>
+#else
+#  include <sys/epoll.h>
+#  include <sys/syscall.h>
+#  ifndef SYS_pidfd_open
+#    define SYS_pidfd_open 434
+#  endif
+#endif
+
+#include <map>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// What an event is about; the tag of an event is (pid << 2) | kind
+enum EventKind { ConnectionEvent = 0, StandardErrorEvent = 1, ExitEvent = 2 };
+
+static uint64_t eventTag(pid_t pid, EventKind kind)
+{
+    return (uint64_t(pid) << 2) | kind;
+}
+
+// Waits for readable file descriptors and exiting processes at the same time
+class EventQueue
+{
+public:
+    EventQueue()
+    {
+#if defined(__FreeBSD__)
+        fd = kqueue();
+#else
+        fd = epoll_create1(EPOLL_CLOEXEC);
+#endif
+    }
+
+    ~EventQueue()
+    {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    bool isValid() const { return fd >= 0; }
+
+    // Closing watchedFd stops watching it
+    bool watchReadable(int watchedFd, uint64_t tag)
+    {
+#if defined(__FreeBSD__)
+        struct kevent change;
+        EV_SET(&change, watchedFd, EVFILT_READ, EV_ADD, 0, 0, reinterpret_cast<void *>(uintptr_t(tag)));
+        return kevent(fd, &change, 1, nullptr, 0, nullptr) == 0;
+#else
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.u64 = tag;
+        return epoll_ctl(fd, EPOLL_CTL_ADD, watchedFd, &event) == 0;
+#endif
+    }
+
+    // Returns false if the exit of pid can't be watched, e.g., because it has
+    // already exited (FreeBSD) or pidfd_open() is not available (Linux < 5.3).
+    // On Linux, *pidFd receives the pidfd to be closed once pid is reaped
+    bool watchExit(pid_t pid, uint64_t tag, int *pidFd)
+    {
+        *pidFd = -1;
+#if defined(__FreeBSD__)
+        struct kevent change;
+        EV_SET(&change, pid, EVFILT_PROC, EV_ADD | EV_ONESHOT, NOTE_EXIT, 0,
+               reinterpret_cast<void *>(uintptr_t(tag)));
+        return kevent(fd, &change, 1, nullptr, 0, nullptr) == 0;
+#else
+        int pfd = int(syscall(SYS_pidfd_open, pid, 0));
+        if (pfd < 0)
+            return false;
+        if (!watchReadable(pfd, tag)) {
+            close(pfd);
+            return false;
+        }
+        *pidFd = pfd;
+        return true;
+#endif
+    }
+
+    // Wait up to timeout milliseconds (-1 for no timeout) and return the tags of the events
+    void wait(int timeout, std::vector<uint64_t> &tags)
+    {
+        tags.clear();
+#if defined(__FreeBSD__)
+        struct kevent events[64];
+        struct timespec ts = { timeout / 1000, (timeout % 1000) * 1000000L };
+        int n = kevent(fd, nullptr, 0, events, 64, timeout < 0 ? nullptr : &ts);
+        for (int i = 0; i < n; i++)
+            tags.push_back(uint64_t(reinterpret_cast<uintptr_t>(events[i].udata)));
+#else
+        struct epoll_event events[64];
+        int n = epoll_wait(fd, events, 64, timeout);
+        for (int i = 0; i < n; i++)
+            tags.push_back(events[i].data.u64);
+#endif
+    }
+
+private:
+    int fd;
+};
+
+// One record per application that is being supervised
+struct Supervised
+{
+    Spawner process;
+    QString name;
+    QString prefetchKey; // The bundle, or the executable if there is none
+    int clientStderrFd = -1; // Where stderr goes once the error window is over
+    int pidFd = -1;
+    bool exitWatched = false;
+    bool inErrorWindow = true;
+    qint64 deadline = 0;
+
+    ~Supervised()
+    {
+        if (pidFd >= 0)
+            close(pidFd);
+        if (clientStderrFd >= 0)
+            close(clientStderrFd);
+    }
+};
+
+QString Supervisor::socketPath()
+{
+    return QFile::decodeName(supervisorSocketPath().c_str());
+}
+
+bool Supervisor::handOff(const LaunchPlan &plan, int *error)
+{
+    const std::string path = supervisorSocketPath();
+    int fd = zygoteConnect(path);
+    if (fd < 0)
+        return false;
+
+    std::vector<QByteArray> storage;
+    const QStringList environment = plan.environment().toStringList();
+    storage.reserve(1 + plan.arguments.size() + environment.size() + 1);
+    std::vector<const char *> argv, envp;
+    storage.push_back(QFile::encodeName(plan.executable));
+    argv.push_back(storage.back().constData());
+    for (const QString &argument : plan.arguments) {
+        storage.push_back(argument.toLocal8Bit());
+        argv.push_back(storage.back().constData());
+    }
+    argv.push_back(nullptr);
+    for (const QString &variable : environment) {
+        storage.push_back(variable.toLocal8Bit());
+        envp.push_back(storage.back().constData());
+    }
+    envp.push_back(nullptr);
+    storage.push_back(QFile::encodeName(QDir::currentPath()));
+    const char *cwd = storage.back().constData();
+
+    const int stdioFds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    int32_t reply = 0;
+    bool ok = zygoteSendRequest(fd, stdioFds, cwd, argv.data(), envp.data())
+            && zygoteReadFully(fd, &reply, sizeof(reply));
+    close(fd);
+    if (!ok) {
+        qDebug() << "# Could not hand off to the supervisor:" << strerror(errno);
+        return false;
+    }
+    *error = reply;
+    return true;
+}
+
+// Start what a client has sent us; returns the record, or nullptr if nothing was started
+static std::unique_ptr<Supervised> startRequest(int fd)
+{
+    int stdioFds[3] = { -1, -1, -1 };
+    std::vector<char> payload;
+    char *cwd = nullptr;
+    std::vector<char *> arguments, environment;
+    if (!zygoteReceiveRequest(fd, stdioFds, payload)
+        || !zygoteParseRequest(payload, &cwd, arguments, environment)) {
+        qWarning() << "Supervisor: Received a malformed request";
+        for (int stdioFd : stdioFds) {
+            if (stdioFd >= 0)
+                close(stdioFd);
+        }
+        return nullptr;
+    }
+
+    std::unique_ptr<Supervised> supervised(new Supervised);
+    Spawner &p = supervised->process;
+    p.setProgram(QFile::decodeName(arguments[0]));
+    QStringList args;
+    for (size_t i = 1; arguments[i] != nullptr; i++)
+        args.append(QString::fromLocal8Bit(arguments[i]));
+    p.setArguments(args);
+    QProcessEnvironment env;
+    for (size_t i = 0; environment[i] != nullptr; i++) {
+        const QString entry = QString::fromLocal8Bit(environment[i]);
+        const int splitPos = entry.indexOf('=');
+        if (splitPos > 0)
+            env.insert(entry.left(splitPos), entry.mid(splitPos + 1));
+    }
+    p.setProcessEnvironment(env);
+    p.setWorkingDirectory(QFile::decodeName(cwd));
+    p.setStandardInputOutputFds(stdioFds[0], stdioFds[1]);
+    p.setCaptureStandardError(true);
+    p.setFatalErrorMatcher(&Launcher::isFatalErrorLine);
+    QString bundle = env.value("LAUNCHED_BUNDLE");
+    const LaunchPolicy policy =
+            LaunchPolicy::forApplication(bundle.isEmpty() ? p.program() : bundle);
+    if (!policy.isEmpty())
+        qDebug() << "# Policy:" << policy.toString();
+    p.setPolicy(policy);
+
+    bool started = p.start();
+    // Registered before replying, since the client holds the start lock of the
+    // bundle until then
+    if (started)
+        RunningRegistry::add(bundle, p.pid());
+    int32_t reply = started ? 0 : p.error();
+    (void)!send(fd, &reply, sizeof(reply), MSG_NOSIGNAL);
+    close(stdioFds[0]);
+    close(stdioFds[1]);
+    supervised->clientStderrFd = stdioFds[2];
+    if (!started)
+        return nullptr;
+
+    supervised->name = QFileInfo(bundle.isEmpty() ? p.program() : bundle).completeBaseName();
+    supervised->prefetchKey = bundle.isEmpty() ? p.program() : bundle;
+    qDebug() << "# Supervising" << p.program() << "with PID" << p.pid();
+    return supervised;
+}
+
+int Supervisor::serve(Launcher *launcher, int errorWindowMsecs)
+{
+    // The file descriptors received from clients must not end up as 0, 1 or 2
+    for (int fd = 0; fd < 3; fd++) {
+        if (fcntl(fd, F_GETFD) < 0)
+            open("/dev/null", O_RDWR);
+    }
+
+    const std::string path = supervisorSocketPath();
+    int listenFd = zygoteListen(path);
+    if (listenFd < 0) {
+        if (errno == EADDRINUSE)
+            qCritical() << "Supervisor: Already running on" << path.c_str();
+        else
+            qCritical() << "Supervisor: Cannot listen on" << path.c_str() << strerror(errno);
+        return 1;
+    }
+
+    EventQueue queue;
+    if (!queue.isValid() || !queue.watchReadable(listenFd, eventTag(0, ConnectionEvent))) {
+        qCritical() << "Supervisor: Cannot create event queue:" << strerror(errno);
+        return 1;
+    }
+
+    // stderr of applications may go to clients that are gone by now
+    signal(SIGPIPE, SIG_IGN);
+
+    qDebug() << "# Supervisor listening on" << path.c_str();
+
+    // Have the package index ready for error messages before they are needed
+    std::thread([]() { PackageIndex::refresh(); }).detach();
+
+    std::map<pid_t, std::unique_ptr<Supervised>> supervised;
+    QElapsedTimer clock;
+    clock.start();
+    std::vector<uint64_t> tags;
+
+    while (true) {
+        // Wake up for the end of the next error window, and regularly
+        // for processes whose exit can't be watched
+        qint64 timeout = -1;
+        for (const auto &entry : supervised) {
+            const Supervised &s = *entry.second;
+            if (s.inErrorWindow) {
+                qint64 remaining = qMax<qint64>(0, s.deadline - clock.elapsed());
+                timeout = (timeout < 0) ? remaining : qMin(timeout, remaining);
+            }
+            if (!s.exitWatched)
+                timeout = (timeout < 0) ? 250 : qMin<qint64>(timeout, 250);
+        }
+
+        queue.wait(int(timeout), tags);
+
+        std::vector<pid_t> exited;
+        for (uint64_t tag : tags) {
+            pid_t pid = pid_t(tag >> 2);
+            EventKind kind = EventKind(tag & 3);
+
+            if (kind == ConnectionEvent) {
+                int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+                if (fd < 0)
+                    continue;
+                if (!zygotePeerIsSameUser(fd)) {
+                    qWarning() << "Supervisor: Rejecting connection from another user";
+                    close(fd);
+                    continue;
+                }
+                std::unique_ptr<Supervised> s = startRequest(fd);
+                close(fd);
+                if (!s)
+                    continue;
+                pid_t newPid = s->process.pid();
+                s->deadline = clock.elapsed() + errorWindowMsecs;
+                queue.watchReadable(s->process.standardErrorFd(),
+                                    eventTag(newPid, StandardErrorEvent));
+                s->exitWatched = queue.watchExit(newPid, eventTag(newPid, ExitEvent), &s->pidFd);
+                supervised[newPid] = std::move(s);
+                continue;
+            }
+
+            auto it = supervised.find(pid);
+            if (it == supervised.end())
+                continue;
+            if (kind != StandardErrorEvent) {
+                exited.push_back(pid);
+                continue;
+            }
+            Supervised &s = *it->second;
+            s.process.readStandardError();
+
+            // A known fatal error is reported right away, even if the application
+            // takes a while to exit; that also ends its error window
+            if (s.inErrorWindow && s.process.hasFatalError()) {
+                s.inErrorWindow = false;
+                launcher->reportApplicationFailure(s.process.program(), s.name,
+                                                   s.process.exitCode(),
+                                                   s.process.readAllStandardError());
+                s.process.setLogStandardError(s.name);
+                s.process.setForwardStandardError(true, s.clientStderrFd);
+            }
+        }
+
+        for (auto &entry : supervised) {
+            Supervised &s = *entry.second;
+            if (!s.exitWatched)
+                exited.push_back(entry.first);
+
+            // Nobody will look at stderr anymore; pass it on to where 'launch' had it going,
+            // and into the log of the application
+            if (s.inErrorWindow && clock.elapsed() >= s.deadline) {
+                s.inErrorWindow = false;
+                s.process.setLogStandardError(s.name);
+                s.process.setForwardStandardError(true, s.clientStderrFd);
+                // By now the application has loaded what it needs to start up
+                Prefetcher::record(s.prefetchKey, entry.first);
+            }
+        }
+
+        for (pid_t pid : exited) {
+            auto it = supervised.find(pid);
+            if (it == supervised.end())
+                continue;
+            Supervised &s = *it->second;
+            if (!s.process.waitForFinished(0))
+                continue; // Still running
+            if (s.inErrorWindow && s.process.exitCode() != 0) {
+                launcher->reportApplicationFailure(s.process.program(), s.name,
+                                                   s.process.exitCode(),
+                                                   s.process.readAllStandardError());
+            }
+            RunningRegistry::remove(pid);
+            supervised.erase(it);
+        }
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef SUPERVISOR_H
+#define SUPERVISOR_H
+
+#include <QString>
+
+#include "LaunchPlan.h"
+
+class Launcher;
+
+/**
+ * @file Supervisor.h
+ * @class Supervisor
+ * @brief One process per session that starts applications and watches them for early failures.
+ *
+ * Without a supervisor, each 'launch' stays around to wait for the application
+ * it has started, so that it can show an error if the application fails within
+ * the first seconds. With 'launch --supervise' running, 'launch' hands the resolved
+ * plan over and exits right away. The supervisor starts the application with the
+ * stdin, stdout, environment and working directory of 'launch'. It then waits for
+ * the stderr and the exit of all applications in a single epoll (Linux) or kqueue
+ * (FreeBSD) loop, so each running application only costs a few file descriptors
+ * and a small record.
+ */
+class Supervisor
+{
+public:
+    /**
+     * @return The path of the socket the supervisor listens on.
+     */
+    static QString socketPath();
+
+    /**
+     * Let a running supervisor start a plan.
+     *
+     * @param plan The resolved plan to be started.
+     * @param error Receives 0 if the application was started, or the errno of the failed execve().
+     * @return False if no supervisor is running, in which case the caller has to start the plan itself.
+     */
+    static bool handOff(const LaunchPlan &plan, int *error);
+
+    /**
+     * Serve requests until killed.
+     *
+     * @param launcher Used to report applications that fail within the error window,
+     *        and to recognize known fatal errors on stderr, which are reported right away.
+     * @param errorWindowMsecs How long after the start a failing application is reported.
+     * @return Only returns if the supervisor could not be started, with the exit code.
+     */
+    static int serve(Launcher *launcher, int errorWindowMsecs = 10 * 1000);
+};
+
+#endif // SUPERVISOR_H
@@ -0,0 +1,164 @@
+#include "Zygote.h"
+#include "ZygoteProtocol.h"
+
+#include <QDebug>
+#include <QFile>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <map>
+#include <vector>
+
+extern char **environ;
+
+// Written to by the SIGCHLD handler so that poll() wakes up when a child exits
+static int sigchldPipe[2] = { -1, -1 };
+
+static void onSigchld(int)
+{
+    int savedErrno = errno;
+    char c = 0;
+    (void)!write(sigchldPipe[1], &c, 1);
+    errno = savedErrno;
+}
+
+// Runs in the forked child: become the client, then run the normal code path
+static int runRequest(int fd, const std::function<int(int, char **)> &run)
+{
+    int stdioFds[3];
+    // Static so that argv and environ stay valid until the process exits
+    static std::vector<char> payload;
+    static std::vector<char *> arguments;
+    static std::vector<char *> environment;
+
+    if (!zygoteReceiveRequest(fd, stdioFds, payload)) {
+        qWarning() << "Zygote: Received a malformed request";
+        return 1;
+    }
+    close(fd);
+
+    for (int i = 0; i < 3; i++) {
+        if (stdioFds[i] != i) {
+            dup2(stdioFds[i], i);
+            close(stdioFds[i]);
+        }
+    }
+
+    char *cwd;
+    if (!zygoteParseRequest(payload, &cwd, arguments, environment)) {
+        qWarning() << "Zygote: Received a malformed request";
+        return 1;
+    }
+
+    if (chdir(cwd) != 0) {
+        qWarning() << "Zygote: Cannot change to" << cwd;
+    }
+    environ = environment.data();
+
+    return run(int(arguments.size() - 1), arguments.data());
+}
+
+QString Zygote::socketPath()
+{
+    return QFile::decodeName(zygoteSocketPath().c_str());
+}
+
+int Zygote::serve(const std::function<int(int, char **)> &run)
+{
+    // The file descriptors received from clients must not end up as 0, 1 or 2
+    for (int fd = 0; fd < 3; fd++) {
+        if (fcntl(fd, F_GETFD) < 0)
+            open("/dev/null", O_RDWR);
+    }
+
+    const std::string path = zygoteSocketPath();
+    int listenFd = zygoteListen(path);
+    if (listenFd < 0) {
+        if (errno == EADDRINUSE)
+            qCritical() << "Zygote: Already running on" << path.c_str();
+        else
+            qCritical() << "Zygote: Cannot listen on" << path.c_str() << strerror(errno);
+        return 1;
+    }
+
+    if (pipe2(sigchldPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        qCritical() << "Zygote: Cannot create pipe:" << strerror(errno);
+        return 1;
+    }
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = onSigchld;
+    action.sa_flags = SA_RESTART | SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    qDebug() << "# Zygote listening on" << path.c_str();
+
+    // The connection of each running child, to send its exit code to when it is done
+    std::map<pid_t, int> clients;
+
+    while (true) {
+        struct pollfd fds[2] = { { listenFd, POLLIN, 0 }, { sigchldPipe[0], POLLIN, 0 } };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR)
+                continue;
+            qCritical() << "Zygote: poll failed:" << strerror(errno);
+            return 1;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            char buffer[64];
+            while (read(sigchldPipe[0], buffer, sizeof(buffer)) > 0) { }
+            int status;
+            pid_t pid;
+            while ((pid = waitpid(-1, &status, WNOHANG)) > 0) {
+                auto it = clients.find(pid);
+                if (it == clients.end())
+                    continue;
+                int32_t exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+                (void)!send(it->second, &exitCode, sizeof(exitCode), MSG_NOSIGNAL);
+                close(it->second);
+                clients.erase(it);
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd < 0)
+                continue;
+            if (!zygotePeerIsSameUser(fd)) {
+                qWarning() << "Zygote: Rejecting connection from another user";
+                close(fd);
+                continue;
+            }
+
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(listenFd);
+                close(sigchldPipe[0]);
+                close(sigchldPipe[1]);
+                for (const auto &client : clients)
+                    close(client.second);
+                signal(SIGCHLD, SIG_DFL);
+                signal(SIGPIPE, SIG_DFL);
+                exit(runRequest(fd, run));
+            }
+            if (pid < 0) {
+                qWarning() << "Zygote: fork failed:" << strerror(errno);
+                close(fd);
+                continue;
+            }
+            clients[pid] = fd;
+        }
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef ZYGOTE_H
+#define ZYGOTE_H
+
+#include <QString>
+
+#include <functional>
+
+/**
+ * @file Zygote.h
+ * @class Zygote
+ * @brief A warm parent process that forks a ready child for each launch request.
+ *
+ * Most of the time 'launch' spends before the application runs goes into dynamic
+ * linking and loading the launch "database". 'launch --zygote' does this once and
+ * then waits on a local socket. For each request from 'launch-client', it forks a
+ * child that takes over the argv, environment, working directory and stdin, stdout
+ * and stderr of the client and then runs the normal launch or open code. The exit
+ * code of the child is sent back to the client.
+ *
+ * The parent must not construct a QApplication (or anything else that starts
+ * threads or connects to the display) before forking; the child does that.
+ */
+class Zygote
+{
+public:
+    /**
+     * Get the path of the socket the zygote listens on.
+     *
+     * @return $XDG_RUNTIME_DIR/launch-zygote, or /tmp/launch-zygote-<uid> as a fallback.
+     */
+    static QString socketPath();
+
+    /**
+     * Serve requests until the process is terminated.
+     *
+     * @param run Called in the forked child with the argc and argv of the client;
+     *            its return value becomes the exit code reported to the client.
+     * @return 1 if the socket could not be set up, e.g., because a zygote is already running.
+     */
+    static int serve(const std::function<int(int, char **)> &run);
+};
+
+#endif // ZYGOTE_H
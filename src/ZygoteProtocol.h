@@ -0,0 +1,283 @@
+#ifndef ZYGOTEPROTOCOL_H
+#define ZYGOTEPROTOCOL_H
+
+// Shared by the zygote ('launch --zygote'), the supervisor ('launch --supervise')
+// and their clients. Does not depend on Qt so that 'launch-client' starts as fast
+// as possible.
+//
+// A request consists of
+// 1. A uint32_t with the length of the payload, sent together with the stdin,
+//    stdout and stderr file descriptors of the client (SCM_RIGHTS)
+// 2. The payload: uint32_t argc, uint32_t envc, then the working directory,
+//    argc arguments and envc "NAME=value" strings, each terminated by '\0'
+// The reply is an int32_t: the exit code for the zygote, 0 or errno for the
+// supervisor.
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+static const uint32_t ZygoteMaxPayloadSize = 4 * 1024 * 1024;
+
+// $XDG_RUNTIME_DIR/<name>, or a per-user path in /tmp
+inline std::string launchSocketPath(const char *name)
+{
+    const char *runtimeDir = getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir == nullptr || runtimeDir[0] == '\0')
+        return std::string("/tmp/") + name + "-" + std::to_string(getuid());
+    return std::string(runtimeDir) + "/" + name;
+}
+
+inline std::string zygoteSocketPath()
+{
+    return launchSocketPath("launch-zygote");
+}
+
+inline std::string supervisorSocketPath()
+{
+    return launchSocketPath("launch-supervisor");
+}
+
+// Only serve the user we are running as
+inline bool zygotePeerIsSameUser(int fd)
+{
+#if defined(__FreeBSD__)
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0)
+        return false;
+    return uid == getuid();
+#else
+    struct ucred credentials;
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        return false;
+    return credentials.uid == getuid();
+#endif
+}
+
+inline bool zygoteSocketAddress(const std::string &path, struct sockaddr_un *address)
+{
+    memset(address, 0, sizeof(*address));
+    address->sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address->sun_path)) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    strncpy(address->sun_path, path.c_str(), sizeof(address->sun_path) - 1);
+    return true;
+}
+
+// Returns a connected socket, or -1 if nobody is listening on path
+inline int zygoteConnect(const std::string &path)
+{
+    struct sockaddr_un address;
+    if (!zygoteSocketAddress(path, &address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address)) != 0) {
+        int savedErrno = errno;
+        close(fd);
+        errno = savedErrno;
+        return -1;
+    }
+    return fd;
+}
+
+// Listen on path, accessible only to the current user. Refuses to steal the
+// socket from a server that is still running (EADDRINUSE), but replaces a stale one
+inline int zygoteListen(const std::string &path)
+{
+    struct sockaddr_un address;
+    if (!zygoteSocketAddress(path, &address))
+        return -1;
+
+    int running = zygoteConnect(path);
+    if (running >= 0) {
+        close(running);
+        errno = EADDRINUSE;
+        return -1;
+    }
+    unlink(path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    mode_t oldUmask = umask(0077);
+    int bound = bind(fd, reinterpret_cast<struct sockaddr *>(&address), sizeof(address));
+    umask(oldUmask);
+    if (bound != 0 || listen(fd, 16) != 0) {
+        int savedErrno = errno;
+        close(fd);
+        errno = savedErrno;
+        return -1;
+    }
+    return fd;
+}
+
+inline bool zygoteWriteFully(int fd, const char *buffer, size_t length)
+{
+    while (length > 0) {
+        ssize_t n = send(fd, buffer, length, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        buffer += n;
+        length -= n;
+    }
+    return true;
+}
+
+inline bool zygoteReadFully(int fd, void *buffer, size_t length)
+{
+    char *p = static_cast<char *>(buffer);
+    while (length > 0) {
+        ssize_t n = read(fd, p, length);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        length -= n;
+    }
+    return true;
+}
+
+// Send a request; argv and envp are terminated by nullptr. Returns false
+// with errno set, or with errno set to E2BIG if the request is too large
+inline bool zygoteSendRequest(int fd, const int stdioFds[3], const char *cwd,
+                              const char *const argv[], const char *const envp[])
+{
+    uint32_t counts[2] = { 0, 0 };
+    std::string payload(sizeof(counts), '\0');
+    payload.append(cwd);
+    payload.push_back('\0');
+    for (; argv[counts[0]] != nullptr; counts[0]++) {
+        payload.append(argv[counts[0]]);
+        payload.push_back('\0');
+    }
+    for (; envp[counts[1]] != nullptr; counts[1]++) {
+        payload.append(envp[counts[1]]);
+        payload.push_back('\0');
+    }
+    memcpy(&payload[0], counts, sizeof(counts));
+
+    if (payload.size() > ZygoteMaxPayloadSize) {
+        errno = E2BIG;
+        return false;
+    }
+
+    uint32_t length = payload.size();
+    struct iovec iov;
+    iov.iov_base = &length;
+    iov.iov_len = sizeof(length);
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+    } control;
+    memset(&control, 0, sizeof(control));
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(3 * sizeof(int));
+    memcpy(CMSG_DATA(cmsg), stdioFds, 3 * sizeof(int));
+
+    return sendmsg(fd, &message, MSG_NOSIGNAL) == sizeof(length)
+            && zygoteWriteFully(fd, payload.data(), payload.size());
+}
+
+// Receive the payload length together with stdin, stdout and stderr of the client
+inline bool zygoteReceiveRequest(int fd, int stdioFds[3], std::vector<char> &payload)
+{
+    uint32_t length = 0;
+    struct iovec iov;
+    iov.iov_base = &length;
+    iov.iov_len = sizeof(length);
+    union {
+        struct cmsghdr align;
+        char buffer[CMSG_SPACE(3 * sizeof(int))];
+    } control;
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.buffer;
+    message.msg_controllen = sizeof(control.buffer);
+
+    ssize_t n;
+    do {
+        n = recvmsg(fd, &message, MSG_CMSG_CLOEXEC);
+    } while (n < 0 && errno == EINTR);
+    if (n != sizeof(length))
+        return false;
+
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&message);
+    if (cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS
+        || cmsg->cmsg_len != CMSG_LEN(3 * sizeof(int)))
+        return false;
+    memcpy(stdioFds, CMSG_DATA(cmsg), 3 * sizeof(int));
+
+    if (length < 2 * sizeof(uint32_t) || length > ZygoteMaxPayloadSize)
+        return false;
+    payload.resize(length);
+    return zygoteReadFully(fd, payload.data(), length);
+}
+
+// Split a received payload in place; arguments and environment are terminated by nullptr
+inline bool zygoteParseRequest(std::vector<char> &payload, char **cwd,
+                               std::vector<char *> &arguments, std::vector<char *> &environment)
+{
+    uint32_t argc, envc;
+    memcpy(&argc, payload.data(), sizeof(argc));
+    memcpy(&envc, payload.data() + sizeof(argc), sizeof(envc));
+    char *p = payload.data() + 2 * sizeof(uint32_t);
+    char *end = payload.data() + payload.size();
+    auto next = [&]() -> char * {
+        char *s = p;
+        char *nul = static_cast<char *>(memchr(p, '\0', end - p));
+        if (nul == nullptr)
+            return nullptr;
+        p = nul + 1;
+        return s;
+    };
+
+    *cwd = next();
+    if (*cwd == nullptr || argc == 0)
+        return false;
+    for (uint32_t i = 0; i < argc; i++) {
+        char *argument = next();
+        if (argument == nullptr)
+            return false;
+        arguments.push_back(argument);
+    }
+    for (uint32_t i = 0; i < envc; i++) {
+        char *variable = next();
+        if (variable == nullptr)
+            return false;
+        environment.push_back(variable);
+    }
+    arguments.push_back(nullptr);
+    environment.push_back(nullptr);
+    return true;
+}
+
+#endif // ZYGOTEPROTOCOL_H
@@ -0,0 +1,68 @@
+// Tiny client for 'launch --zygote'. Deliberately does not use Qt so that
+// it starts as fast as possible; all the work happens in a child forked
+// from the zygote, which already has Qt and the launch "database" loaded.
+//
+// Usage is the same as for 'launch'; invoked under a name ending in "open",
+// it behaves like 'open'. If no zygote is running, it executes 'launch' or
+// 'open' instead, so it can be used as a drop-in replacement.
+
+#include "ZygoteProtocol.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+extern char **environ;
+
+int main(int argc, char *argv[])
+{
+    // argv[0] tells us which tool to be and is replaced by its name below, so an
+    // empty argv, which execve() allows, would leave the list unterminated
+    if (argc < 1) {
+        fprintf(stderr, "launch-client: Started without a program name\n");
+        return 1;
+    }
+    std::string invokedAs = argv[0];
+    std::string tool = "launch";
+    if (invokedAs.size() >= 4 && invokedAs.compare(invokedAs.size() - 4, 4, "open") == 0)
+        tool = "open";
+
+    const std::string path = zygoteSocketPath();
+    int fd = zygoteConnect(path);
+    if (fd < 0) {
+        // No zygote running; do the work ourselves
+        argv[0] = const_cast<char *>(tool.c_str());
+        execvp(tool.c_str(), argv);
+        fprintf(stderr, "%s: Cannot execute %s: %s\n", invokedAs.c_str(), tool.c_str(),
+                strerror(errno));
+        return 127;
+    }
+
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)) == nullptr)
+        strcpy(cwd, "/");
+
+    // Send our arguments and environment together with our stdin, stdout and stderr
+    argv[0] = const_cast<char *>(tool.c_str());
+    const int stdioFds[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    if (!zygoteSendRequest(fd, stdioFds, cwd, argv, environ)) {
+        if (errno == E2BIG)
+            fprintf(stderr, "%s: Arguments and environment too large\n", invokedAs.c_str());
+        else
+            fprintf(stderr, "%s: Cannot send request to %s: %s\n", invokedAs.c_str(),
+                    path.c_str(), strerror(errno));
+        return 1;
+    }
+
+    // Blocks until the child forked for us has exited, just like 'launch' would
+    int32_t exitCode = 1;
+    if (!zygoteReadFully(fd, &exitCode, sizeof(exitCode))) {
+        fprintf(stderr, "%s: Lost connection to %s\n", invokedAs.c_str(), path.c_str());
+        return 1;
+    }
+    return exitCode;
+}
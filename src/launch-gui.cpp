@@ -0,0 +1,359 @@
+#include <QApplication>
+#include <QDebug>
+#include <QIcon>
+#include <QMessageBox>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QStyle>
+
+#include <xcb/xcb.h>
+
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "ApplicationInfo.h"
+#include "ApplicationSelectionDialog.h"
+#include "Platform.h"
+
+/*
+ * Everything 'launch', 'open' and 'launch-service' need a graphical user interface for.
+ * Executed by GuiHelper only when a dialog has to be shown or windows have to be
+ * activated, so that the common path does not have to load Qt Widgets and XCB.
+ *
+ * Usage:
+ * launch-gui warning <title> <text>
+ * launch-gui details <title> <text> <detailed text>
+ * launch-gui question <title> <text>                   Exits with 0 for "yes"
+ * launch-gui choose <file or URL> <MIME type>          Prints the chosen application
+ * launch-gui activate <bundle> [--wait <msecs>] [<pid>...]
+ *                                                      Exits with 0 if windows were activated
+ */
+
+// A connection to the X server of its own, so that requests can be pipelined
+// and events waited for without going through Qt
+class WindowSystem
+{
+public:
+    WindowSystem()
+    {
+        int screenNumber = 0;
+        m_connection = xcb_connect(nullptr, &screenNumber);
+        if (xcb_connection_has_error(m_connection))
+            return;
+        xcb_screen_iterator_t screens = xcb_setup_roots_iterator(xcb_get_setup(m_connection));
+        for (int i = 0; i < screenNumber && screens.rem; i++)
+            xcb_screen_next(&screens);
+        if (!screens.rem)
+            return;
+        m_root = screens.data->root;
+
+        // Hear about changes of _NET_ACTIVE_WINDOW from now on
+        const uint32_t eventMask = XCB_EVENT_MASK_PROPERTY_CHANGE;
+        xcb_change_window_attributes(m_connection, m_root, XCB_CW_EVENT_MASK, &eventMask);
+
+        const char *names[] = { "_NET_CLIENT_LIST", "_NET_WM_PID", "_NET_ACTIVE_WINDOW" };
+        xcb_intern_atom_cookie_t cookies[3];
+        for (int i = 0; i < 3; i++)
+            cookies[i] = xcb_intern_atom(m_connection, true, strlen(names[i]), names[i]);
+        xcb_atom_t *atoms[] = { &m_clientList, &m_wmPid, &m_activeWindow };
+        for (int i = 0; i < 3; i++) {
+            xcb_intern_atom_reply_t *reply = xcb_intern_atom_reply(m_connection, cookies[i], nullptr);
+            if (reply) {
+                *atoms[i] = reply->atom;
+                free(reply);
+            }
+        }
+    }
+
+    ~WindowSystem() { xcb_disconnect(m_connection); }
+
+    bool isValid() const
+    {
+        return m_clientList != XCB_ATOM_NONE && m_wmPid != XCB_ATOM_NONE
+                && m_activeWindow != XCB_ATOM_NONE;
+    }
+
+    // The process ID of every managed window, from _NET_CLIENT_LIST and _NET_WM_PID.
+    // All _NET_WM_PID requests are sent before the first reply is read, so this takes
+    // one round-trip to the X server more than reading _NET_CLIENT_LIST, no matter
+    // how many windows there are
+    std::vector<std::pair<xcb_window_t, uint32_t>> windowPids()
+    {
+        std::vector<std::pair<xcb_window_t, uint32_t>> result;
+        std::vector<xcb_window_t> windows;
+        xcb_get_property_reply_t *listReply = xcb_get_property_reply(
+                m_connection,
+                xcb_get_property(m_connection, false, m_root, m_clientList, XCB_ATOM_WINDOW, 0,
+                                 65536),
+                nullptr);
+        if (listReply) {
+            const xcb_window_t *data =
+                    static_cast<const xcb_window_t *>(xcb_get_property_value(listReply));
+            windows.assign(data,
+                           data + xcb_get_property_value_length(listReply) / sizeof(xcb_window_t));
+            free(listReply);
+        }
+
+        std::vector<xcb_get_property_cookie_t> cookies;
+        cookies.reserve(windows.size());
+        for (xcb_window_t window : windows)
+            cookies.push_back(xcb_get_property(m_connection, false, window, m_wmPid,
+                                               XCB_ATOM_CARDINAL, 0, 1));
+        for (size_t i = 0; i < windows.size(); i++) {
+            xcb_get_property_reply_t *reply =
+                    xcb_get_property_reply(m_connection, cookies[i], nullptr);
+            if (!reply)
+                continue;
+            if (xcb_get_property_value_length(reply) == sizeof(uint32_t))
+                result.emplace_back(windows[i],
+                                    *static_cast<const uint32_t *>(xcb_get_property_value(reply)));
+            free(reply);
+        }
+        return result;
+    }
+
+    // Asks the window manager to activate window, like KWindowSystem::forceActiveWindow():
+    // as a pager, so that focus stealing prevention does not get in the way
+    void requestActivation(xcb_window_t window)
+    {
+        xcb_client_message_event_t event;
+        memset(&event, 0, sizeof(event));
+        event.response_type = XCB_CLIENT_MESSAGE;
+        event.format = 32;
+        event.window = window;
+        event.type = m_activeWindow;
+        event.data.data32[0] = 2; // Source indication: pager
+        event.data.data32[1] = XCB_CURRENT_TIME;
+        xcb_send_event(m_connection, false, m_root,
+                       XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY | XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT,
+                       reinterpret_cast<const char *>(&event));
+        xcb_flush(m_connection);
+    }
+
+    xcb_window_t activeWindow()
+    {
+        xcb_window_t window = XCB_WINDOW_NONE;
+        xcb_get_property_reply_t *reply = xcb_get_property_reply(
+                m_connection,
+                xcb_get_property(m_connection, false, m_root, m_activeWindow, XCB_ATOM_WINDOW, 0,
+                                 1),
+                nullptr);
+        if (reply) {
+            if (xcb_get_property_value_length(reply) == sizeof(xcb_window_t))
+                window = *static_cast<const xcb_window_t *>(xcb_get_property_value(reply));
+            free(reply);
+        }
+        return window;
+    }
+
+    // Waits until the window manager has made one of windows the active window,
+    // or until timeoutMsecs have passed
+    bool waitForActiveWindow(const std::vector<xcb_window_t> &windows, int timeoutMsecs)
+    {
+        auto isOurs = [&windows](xcb_window_t window) {
+            return std::find(windows.begin(), windows.end(), window) != windows.end();
+        };
+        // Reading the property also makes sure that our requests have been processed
+        if (isOurs(activeWindow()))
+            return true;
+
+        QElapsedTimer clock;
+        clock.start();
+        while (waitForPropertyChange(m_activeWindow, timeoutMsecs - clock.elapsed())) {
+            if (isOurs(activeWindow()))
+                return true;
+        }
+        return false;
+    }
+
+    // Waits until processes in pids have mapped a window, or until timeoutMsecs have passed
+    std::vector<xcb_window_t> waitForWindowsOf(const QList<unsigned int> &pids, int timeoutMsecs)
+    {
+        std::vector<xcb_window_t> result;
+        QElapsedTimer clock;
+        clock.start();
+        // The client list may have changed between our last look and the event mask
+        // taking effect, so look once more before waiting
+        do {
+            for (const auto &windowPid : windowPids()) {
+                if (pids.contains(windowPid.second))
+                    result.push_back(windowPid.first);
+            }
+        } while (result.empty()
+                 && waitForPropertyChange(m_clientList, timeoutMsecs - clock.elapsed()));
+        return result;
+    }
+
+private:
+    // Waits for a change of a property of the root window; false on timeout
+    bool waitForPropertyChange(xcb_atom_t atom, qint64 timeoutMsecs)
+    {
+        QElapsedTimer clock;
+        clock.start();
+        const int fd = xcb_get_file_descriptor(m_connection);
+        for (;;) {
+            xcb_generic_event_t *event;
+            while ((event = xcb_poll_for_event(m_connection)) != nullptr) {
+                const bool changed = (event->response_type & ~0x80) == XCB_PROPERTY_NOTIFY
+                        && reinterpret_cast<xcb_property_notify_event_t *>(event)->atom == atom;
+                free(event);
+                if (changed)
+                    return true;
+            }
+            if (xcb_connection_has_error(m_connection))
+                return false;
+            const qint64 remaining = timeoutMsecs - clock.elapsed();
+            if (remaining <= 0)
+                return false;
+            struct pollfd pfd = { fd, POLLIN, 0 };
+            poll(&pfd, 1, int(remaining));
+        }
+    }
+
+    xcb_connection_t *m_connection = nullptr;
+    xcb_window_t m_root = XCB_WINDOW_NONE;
+    xcb_atom_t m_clientList = XCB_ATOM_NONE;
+    xcb_atom_t m_wmPid = XCB_ATOM_NONE;
+    xcb_atom_t m_activeWindow = XCB_ATOM_NONE;
+};
+
+// Bring the windows of a running bundle to the front. The windows of knownPids,
+// which come from the running registry, are taken as they are; if they have none
+// yet, they are waited for for up to waitMsecs, since the bundle may just be
+// starting. Only then, e.g., because the registered process has left a child
+// process behind, are the environments of the processes of all windows looked at
+static bool activateWindowsOfBundle(const QString &bundle, const QList<unsigned int> &knownPids,
+                                    int waitMsecs)
+{
+    WindowSystem windowSystem;
+    if (!windowSystem.isValid())
+        return false;
+    const auto windows = windowSystem.windowPids();
+    std::vector<xcb_window_t> activated;
+    for (const auto &windowPid : windows) {
+        if (knownPids.contains(windowPid.second))
+            activated.push_back(windowPid.first);
+    }
+    if (activated.empty() && waitMsecs > 0 && !knownPids.isEmpty()) {
+        qDebug() << "# Waiting for the starting application to map a window";
+        activated = windowSystem.waitForWindowsOf(knownPids, waitMsecs);
+    }
+
+    if (activated.empty()) {
+        // Applications often have several windows, but each process is looked up once
+        QList<unsigned int> pids;
+        for (const auto &windowPid : windows)
+            pids.append(windowPid.second);
+        const QHash<unsigned int, QString> bundles = ApplicationInfo::bundlePathsForPIds(pids);
+        QHash<unsigned int, bool> ownedByUs;
+        for (const auto &windowPid : windows) {
+            const xcb_window_t wid = windowPid.first;
+            const unsigned int pid = windowPid.second;
+            if (bundles.value(pid) != bundle)
+                continue;
+            // Avoid bringing to the front windows of other users (e.g., if we want to run as root)
+            auto owned = ownedByUs.constFind(pid);
+            if (owned == ownedByUs.constEnd())
+                owned = ownedByUs.insert(pid, Platform::processOwner(pid) == geteuid());
+            if (!owned.value()) {
+                qDebug() << "# Not activating window" << wid
+                         << "because it is running under a different user ID";
+                continue;
+            }
+            activated.push_back(wid);
+        }
+    }
+
+    if (activated.empty())
+        return false;
+    for (xcb_window_t wid : activated) {
+        qDebug() << "# Activating window" << wid;
+        windowSystem.requestActivation(wid);
+    }
+    // The windows are activated once the requests have reached the X server, but
+    // wait for the window manager so that the caller knows it has worked
+    if (windowSystem.waitForActiveWindow(activated, 500))
+        qDebug() << "# The window manager has activated the window";
+    else
+        qDebug() << "# The window manager has not confirmed the activation in time";
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    // Activating windows needs neither widgets nor a connection of Qt to the X server
+    if (argc >= 3 && strcmp(argv[1], "activate") == 0) {
+        int i = 3;
+        int waitMsecs = 0;
+        if (i + 1 < argc && strcmp(argv[i], "--wait") == 0) {
+            waitMsecs = atoi(argv[i + 1]);
+            i += 2;
+        }
+        QList<unsigned int> knownPids;
+        for (; i < argc; i++)
+            knownPids.append(QByteArray(argv[i]).toUInt());
+        return activateWindowsOfBundle(QString::fromLocal8Bit(argv[2]), knownPids, waitMsecs)
+                ? 0
+                : 1;
+    }
+
+    QApplication app(argc, argv);
+
+    QStringList args = app.arguments();
+    args.pop_front();
+    QString command = args.isEmpty() ? QString() : args.takeFirst();
+
+    if (command == "warning" && args.length() == 2) {
+        QMessageBox::warning(nullptr, args[0], args[1]);
+        return 0;
+    }
+
+    if (command == "details" && args.length() == 3) {
+        QMessageBox qmesg;
+
+        // Make this error message not appear in the Dock // FIXME: Does not work,
+        // why?
+        qmesg.setWindowFlag(Qt::SubWindow);
+
+        // If we can't make the icon go away in the Dock, at least make it a
+        // non-placeholder icon Not sure if the Dock is already reflecting the
+        // WindowIcon correctly
+        // FIXME: Does not work, why?
+        QIcon icon = QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning);
+        qmesg.setWindowIcon(icon);
+
+        qmesg.setWindowTitle(args[0]);
+        qmesg.setText(args[1]);
+        qmesg.setDetailedText(args[2]);
+        qmesg.setIcon(QMessageBox::Warning);
+        qmesg.setSizeGripEnabled(true);
+        qmesg.exec();
+        return 0;
+    }
+
+    if (command == "question" && args.length() == 2) {
+        QMessageBox::StandardButton response = QMessageBox::question(
+                nullptr, args[0], args[1], QMessageBox::Yes | QMessageBox::No);
+        return response == QMessageBox::Yes ? 0 : 1;
+    }
+
+    if (command == "choose" && args.length() == 2) {
+        QString fileOrProtocol = args[0];
+        QString mimeType = args[1];
+        ApplicationSelectionDialog *dlg =
+                new ApplicationSelectionDialog(&fileOrProtocol, &mimeType, true, false, nullptr);
+        if (dlg->exec() != QDialog::Accepted)
+            return 1; // Cancelled by the user
+        printf("%s\n", qPrintable(dlg->getSelectedApplication()));
+        return 0;
+    }
+
+    qCritical() << "USAGE:" << argv[0] << "warning|details|question|choose|activate <arguments>";
+    return 2;
+}
@@ -0,0 +1,50 @@
+#include <QCoreApplication>
+#include <QDBusConnection>
+#include <QDebug>
+
+#include "LaunchService.h"
+#include "PackageIndex.h"
+
+#include <thread>
+
+/*
+ * Session bus service that resolves and launches applications, so that
+ * Filer, Menu and others don't need to spawn 'open' or 'launch' for each document.
+ *
+ * Service: local.Launch
+ * Path: /
+ * Methods: Resolve(path), Open(paths), Launch(application, arguments)
+ *
+ * Example:
+ * dbus-send --session --print-reply --dest=local.Launch / local.Launch.Resolve string:/etc/hosts
+ */
+
+int main(int argc, char *argv[])
+{
+    // Dialogs are shown by 'launch-gui', so the service itself needs no QApplication
+    QCoreApplication app(argc, argv);
+
+    QDBusConnection connection = QDBusConnection::sessionBus();
+    if (!connection.isConnected()) {
+        qCritical() << "Cannot connect to the D-Bus session bus";
+        return 1;
+    }
+
+    LaunchService service;
+    if (!connection.registerObject("/", &service, QDBusConnection::ExportAllSlots)) {
+        qCritical() << "Cannot register object on the D-Bus session bus";
+        return 1;
+    }
+    if (!connection.registerService("local.Launch")) {
+        qCritical() << "Cannot register local.Launch on the D-Bus session bus;"
+                    << "is launch-service already running?";
+        return 1;
+    }
+
+    // Have the package index ready for error messages before they are needed
+    std::thread refresher([]() { PackageIndex::refresh(); });
+
+    const int result = app.exec();
+    refresher.join();
+    return result;
+}
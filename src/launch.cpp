@@ -1,6 +1,13 @@
-#include <QApplication>
+#include <QCoreApplication>
+#include <QMimeDatabase>
 
 #include "launcher.h"
+#include "Supervisor.h"
+#include "Zygote.h"
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
 
 /*
  * All documents shall be opened through this tool on helloDesktop
@@ -18,8 +25,7 @@
  * 4. As a fallback, via Baloo? (not implemented yet)
  *
  * launch.db is populated
- * 1. By this tool (currently each time it is invoked; could be optimized to: only if application is
-not found)
+ * 1. By this tool (only if an application has to be looked up by name or MIME type)
  * 2. By the file manager when one looks at applications (can be implemented natively or using
 bundle-thumbnailer)
  *
@@ -32,11 +38,20 @@ in,
  *
  * Usage:
  * launch <application to be launched> [<arguments>]    Launch the specified application
+ * launch --exec <application> [<arguments>]            Replace this process with the application
+ *                                                       instead of watching it for errors
+ * launch --prepare <application> [<arguments>]         Resolve the application and read its files
+ *                                                       ahead of a launch that is likely to follow
+ * launch --batch [--null]                               Launch each request read from stdin, one
+ *                                                       per line (or NUL-separated), and write one
+ *                                                       line of JSON per request to stdout
+ * launch --zygote                                       Serve requests from launch-client
+ * launch --supervise                                    Start and watch applications for all
+ *                                                       other 'launch' processes of the session
 
 Similar to https://github.com/probonopd/appwrapper and GNUstep openapp
 
 TODO:
-* Possibly optimize for launch speed by only populating launch.db if the application is not found
 * Make the behavior resemble /usr/local/GNUstep/System/Tools/openapp (a bash script)
 
 user@FreeBSD$ /usr/local/GNUstep/System/Tools/openapp --help
@@ -53,41 +68,118 @@ will also list all paths that are attempted.
 
 */
 
-int main(int argc, char *argv[])
+// Requests come from stdin and results go to stdout, so the applications get
+// /dev/null and our stderr instead, lest they read requests or write between results
+static int runBatch(Launcher *launcher, bool forOpen, bool nullSeparated)
 {
+    const int inputFd = fcntl(STDIN_FILENO, F_DUPFD_CLOEXEC, 3);
+    const int outputFd = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+    const int nullFd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (inputFd < 0 || outputFd < 0 || nullFd < 0) {
+        perror("launch --batch");
+        return 1;
+    }
+    dup2(nullFd, STDIN_FILENO);
+    dup2(STDERR_FILENO, STDOUT_FILENO);
+    close(nullFd);
+
+    FILE *input = fdopen(inputFd, "r");
+    FILE *output = fdopen(outputFd, "w");
+    const int result = launcher->batch(input, output, forOpen, nullSeparated);
+    fclose(input);
+    fclose(output);
+    return result;
+}
 
-    QApplication app(argc, argv);
-
-    Launcher *launcher = new Launcher();
-
-    // Setting a busy cursor in this way seems only to affect the own application's windows
-    // rather than the full screen, which is why it is not suitable for this tool
-    // QApplication::setOverrideCursor(Qt::WaitCursor);
-
-    // Launch an application but initially watch for errors and display a Qt error message
-    // if needed. After some timeout, detach the process of the application, and exit this helper
-
-    QStringList args = app.arguments();
-
+// Launch or open depending on the name under which we were invoked
+static int dispatch(Launcher *launcher, const QString &invokedAs, QStringList args)
+{
     args.pop_front();
 
-    launcher->discoverApplications();
+    bool prepareOnly = false;
+    bool batch = false;
+    bool nullSeparated = false;
+    if (!args.isEmpty() && args.first() == "--batch") {
+        args.pop_front();
+        batch = true;
+        if (!args.isEmpty() && args.first() == "--null") {
+            args.pop_front();
+            nullSeparated = true;
+        }
+    } else if (!args.isEmpty() && args.first() == "--exec") {
+        args.pop_front();
+        launcher->setExecInPlace(true);
+    } else if (!args.isEmpty() && args.first() == "--prepare") {
+        args.pop_front();
+        prepareOnly = true;
+    }
 
-    if (QFileInfo(argv[0]).fileName() == "launch") {
-        if (args.isEmpty()) {
-            qCritical() << "USAGE:" << argv[0] << "<application to be launched> [<arguments>]";
+    if (QFileInfo(invokedAs).fileName() == "launch") {
+        if (batch ? !args.isEmpty() : args.isEmpty()) {
+            qCritical() << "USAGE:" << invokedAs << "[--exec|--prepare] <application to be launched> [<arguments>]";
+            qCritical() << "      " << invokedAs << "--batch [--null] < requests";
             exit(1);
         }
+        if (batch)
+            return runBatch(launcher, false, nullSeparated);
+        if (prepareOnly)
+            return launcher->prepare(args, false);
         return launcher->launch(args);
     }
 
-    if (QFileInfo(argv[0]).fileName().endsWith("open")) {
-        if (args.isEmpty()) {
-            qCritical() << "USAGE:" << argv[0] << "<document to be opened>";
+    if (QFileInfo(invokedAs).fileName().endsWith("open")) {
+        if (batch ? !args.isEmpty() : args.isEmpty()) {
+            qCritical() << "USAGE:" << invokedAs << "[--exec|--prepare] <document to be opened> [<document>...]";
+            qCritical() << "      " << invokedAs << "--batch [--null] < requests";
             exit(1);
         }
+        if (batch)
+            return runBatch(launcher, true, nullSeparated);
+        if (prepareOnly)
+            return launcher->prepare(args, true);
         return launcher->open(args);
     }
 
     return 1;
 }
+
+int main(int argc, char *argv[])
+{
+
+    // 'launch --zygote' loads the launch "database" once and then forks a ready
+    // child for each request from 'launch-client'. The QCoreApplication is only
+    // constructed in the child, since it must not be shared across fork(). A child
+    // that can't find an application discovers again, for itself and, through
+    // launch.db, for later children
+    if (argc == 2 && QString(argv[1]) == "--zygote") {
+        Launcher *launcher = new Launcher();
+        launcher->discoverApplications();
+        QMimeDatabase().mimeTypeForName("text/plain"); // Load the MIME database
+        return Zygote::serve([launcher](int argc, char **argv) {
+            QCoreApplication app(argc, argv);
+            return dispatch(launcher, QString::fromLocal8Bit(argv[0]), app.arguments());
+        });
+    }
+
+    // 'launch --supervise' starts applications on behalf of other 'launch' processes
+    // and watches all of them for early failures, so that those can exit right away
+    if (argc == 2 && QString(argv[1]) == "--supervise") {
+        QCoreApplication app(argc, argv);
+        Launcher *launcher = new Launcher();
+        return Supervisor::serve(launcher, Launcher::errorWindowMsecs());
+    }
+
+    // No QApplication; dialogs are shown by 'launch-gui' only when needed (see GuiHelper.h)
+    QCoreApplication app(argc, argv);
+
+    Launcher *launcher = new Launcher();
+
+    // Launch an application but initially watch for errors and display an error message
+    // if needed. After some timeout, detach the process of the application, and exit this helper
+
+    // Applications are only discovered once an application has to be looked up by name
+    // or MIME type; explicit paths to executables and bundles, directories and URLs
+    // with a default handler are spawned without touching the launch "database"
+
+    return dispatch(launcher, QString::fromLocal8Bit(argv[0]), app.arguments());
+}
@@ -1,119 +1,167 @@
 #include "launcher.h"
-#include "ApplicationSelectionDialog.h"
 #include <unistd.h>
-#include <QApplication>
-#include <NETWM>
-#include <X11/Xlib.h>
-#include <X11/Xatom.h>
+#include "ErrorRules.h"
 #include "Executable.h"
-#include <QMessageBox>
-
-Launcher::Launcher() : db(new DbManager()) { }
+#include "GuiHelper.h"
+#include "LaunchPolicy.h"
+#include "MenuNotifier.h"
+#include "PackageIndex.h"
+#include "PlanCache.h"
+#include "Prefetcher.h"
+#include "RunningRegistry.h"
+#include "Spawner.h"
+#include "Supervisor.h"
+
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include <algorithm>
+#include <vector>
+
+Launcher::Launcher()
+    : db(nullptr), interactive(true), execInPlace(false), startedFd(-1)
+{
+    // Set by launchAll() of the 'open' that has started us; not for the application
+    bool ok = false;
+    const int fd = qEnvironmentVariableIntValue("LAUNCH_STARTED_FD", &ok);
+    if (ok && fd > STDERR_FILENO && fcntl(fd, F_SETFD, FD_CLOEXEC) == 0)
+        startedFd = fd;
+    qunsetenv("LAUNCH_STARTED_FD");
+}
 
 Launcher::~Launcher()
 {
-    db->~DbManager();
+    delete db;
+}
+
+// Opening the launch "database" creates its directories and garbage collects
+// broken symlinks, so only do it once it is actually needed; explicit paths to
+// executables and bundles are resolved without it
+DbManager *Launcher::database()
+{
+    if (!db) {
+        db = new DbManager();
+    }
+    return db;
+}
+
+// Run discovery at most once, and only when looking up applications by name
+// or MIME type in the launch "database"
+void Launcher::ensureDiscovered()
+{
+    if (!discovered.isValid()) {
+        discoverApplications();
+    }
+}
+
+// Touched after each discovery, so that processes that share the launch
+// "database" but not their memory, such as the children of the zygote, can
+// tell whether another one has just discovered
+static QString discoveryStampPath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation)
+            + "/launch/discovered";
+}
+
+// After a lookup in the launch "database" has found nothing, discover again in
+// case the application has been installed since; long-running processes such as
+// the service and the zygote would otherwise never see it. Returns whether
+// discovery ran, which it does not if this or another process already has within
+// the last RediscoveryIntervalMsecs
+bool Launcher::rediscover()
+{
+    if (discovered.isValid() && discovered.elapsed() < RediscoveryIntervalMsecs) {
+        return false;
+    }
+    const QDateTime stamp = QFileInfo(discoveryStampPath()).lastModified();
+    if (stamp.isValid()
+        && qAbs(stamp.msecsTo(QDateTime::currentDateTime())) < RediscoveryIntervalMsecs) {
+        return false;
+    }
+    qDebug() << "# Not found in launch.db, discovering applications again";
+    discoverApplications();
+    return true;
+}
+
+void Launcher::setInteractive(bool interactive)
+{
+    this->interactive = interactive;
+}
+
+void Launcher::setExecInPlace(bool execInPlace)
+{
+    this->execInPlace = execInPlace;
+}
+
+QString Launcher::errorString() const
+{
+    return lastError;
+}
+
+// Show an error to the user, or only remember it for errorString()
+// if we are running without a user to talk to (e.g., as a D-Bus service)
+void Launcher::reportError(const QString &message, const QString &title)
+{
+    qDebug() << "# Error:" << message;
+    lastError = message;
+    if (interactive) {
+        GuiHelper::warning(title, message);
+    }
+}
+
+// Make sure that a file with a shebang or an ELF header can be executed,
+// asking the user for permission to set the executable bit if needed
+bool Launcher::ensureExecutable(const QString &path)
+{
+    if (QFileInfo(path).isExecutable()) {
+        return true;
+    }
+    if (interactive && Executable::askUserToMakeExecutable(path)) {
+        return true;
+    }
+    // Not reported in a dialog; the user has just declined
+    lastError = QString("'%1' is not executable.").arg(path);
+    return false;
 }
 
 // If a package needs to be updated, tell the user how to do this,
-// or even offer to do it
+// or even offer to do it. Remembered per file
 QString Launcher::getPackageUpdateCommand(QString pathToInstalledFile)
 {
-    QString candidate = QStandardPaths::findExecutable("pkg");
-    if (candidate != "") {
-        // We are on FreeBSD
-        QProcess p;
-        QString exe = "pkg which " + pathToInstalledFile;
-        p.start(exe);
-        p.waitForFinished();
-        QString output(p.readAllStandardOutput());
-        if (output != "") {
-            qDebug() << output;
-            QRegExp rx(".* was installed by package (.*)-(.*)\n");
-            if (rx.indexIn(output) == 0) {
-                return QString("sudo pkg install %1").arg(rx.cap(1));
-            }
-        }
+    static QHash<QString, QString> commands;
+    auto it = commands.constFind(pathToInstalledFile);
+    if (it != commands.constEnd()) {
+        return it.value();
     }
-    // TODO: Implement the same for deb and rpm...
-    // In all other cases, return a blank string
-    return "";
+    QString command = PackageIndex::updateCommand(pathToInstalledFile);
+    commands.insert(pathToInstalledFile, command);
+    return command;
 }
 
 // Translate cryptic errors into clear text, and possibly even offer buttons to
 // take action
-void Launcher::handleError(QDetachableProcess *p, QString errorString)
+void Launcher::handleError(const QString &program, QString errorString)
 {
-    QMessageBox qmesg;
-
-    QFileInfo fi(p->program());
+    QFileInfo fi(program);
     QString title = fi.completeBaseName(); // https://doc.qt.io/qt-5/qfileinfo.html#completeBaseName
 
-    // Make this error message not appear in the Dock // FIXME: Does not work,
-    // why?
-    qmesg.setWindowFlag(Qt::SubWindow);
-
-    // If we can't make the icon go away in the Dock, at least make it a
-    // non-placeholder icon Not sure if the Dock is already reflecting the
-    // WindowIcon correctly
-    // FIXME: Does not work, why?
-    QIcon icon = QApplication::style()->standardIcon(QStyle::SP_MessageBoxWarning);
-    qmesg.setWindowIcon(icon);
-
-    QRegExp rx(".*ld-elf.so.1: (.*): version (.*) required by (.*) not found.*");
-    QRegExp rxPy(".*ModuleNotFoundError: No module named '(.*)'.*");
-
-    if (errorString.contains("FATAL: kernel too old")) {
-        QString cleartextString =
-                "The Linux compatibility layer reports an older kernel version than "
-                "what is required to run this application.\n\n"
-                "Please run\nsudo sysctl compat.linux.osrelease=5.0.0\nand try again.";
-        qmesg.warning(nullptr, title, cleartextString);
-    } else if (errorString.contains("setuid_sandbox_host.cc")) {
-        QString cleartextString = "Cannot run Chromium-based applications with a sandbox.\n"
-                                  "Please try running it with the --no-sandbox argument.";
-        qmesg.warning(nullptr, title, cleartextString);
-    } else if (rx.indexIn(errorString) == 0) {
-        QString outdatedLib = rx.cap(1);
-        QString versionNeeded = rx.cap(2);
-        QFile f(outdatedLib);
-        QFileInfo fileInfo(f.fileName());
-        QString outdatedLibShort(fileInfo.fileName());
-        QString cleartextString =
-                QString("%1 application requires at least version %2 of %3 to run.")
-                        .arg(title)
-                        .arg(versionNeeded)
-                        .arg(outdatedLibShort);
-        if (getPackageUpdateCommand(outdatedLib) != "") {
-            cleartextString.append(QString("\n\nPlease update it with\n%1\nand try again.")
-                                           .arg(getPackageUpdateCommand(outdatedLib)));
-        } else {
-            cleartextString.append(QString("\n\nPlease update it and try again.")
-                                           .arg(getPackageUpdateCommand(outdatedLib)));
-        }
-        qmesg.warning(nullptr, title, cleartextString);
-    } else if (rxPy.indexIn(errorString) == 0) {
-        QString missingPyModule = rxPy.cap(1);
-        QString cleartextString = QString("%1 requires the Python module %2 to "
-                                          "run.\n\nPlease install it and try again.")
-                                          .arg(title)
-                                          .arg(missingPyModule);
-        qmesg.warning(nullptr, title, cleartextString);
+    ErrorMatch match = ErrorRules::instance().match(errorString);
+    if (match.rule) {
+        QString cleartextString = ErrorRules::message(
+                match, title,
+                [this](const QString &path) { return getPackageUpdateCommand(path); });
+        GuiHelper::warning(title, cleartextString);
     } else {
 
-        QStringList lines = errorString.split("\n");
-
-        // Remove all lines from QStringList lines that contain "from LD_PRELOAD
-        // cannot be preloaded" or "no version information available as these most
-        // likely are not relevant to the user
-        for (QStringList::iterator it = lines.begin(); it != lines.end();) {
-            if ((*it).contains("from LD_PRELOAD cannot be preloaded")
-                || (*it).contains("no version information available (required by")) {
-                it = lines.erase(it);
-            } else {
-                ++it;
-            }
-        }
+        // Lines such as "from LD_PRELOAD cannot be preloaded" most likely are not
+        // relevant to the user and have been dropped by the rules
+        QStringList lines = match.remainingLines;
 
         QString cleartextString = lines.join("\n");
         if (lines.length() > 10) {
@@ -121,29 +169,71 @@ void Launcher::handleError(QDetachableProcess *p, QString errorString)
             QString text = QObject::tr(QString("%1 has quit unexpectedly.\n\n\n").arg(title).toUtf8());
             // Append non-breaking spaces to the text to increase width
             text.append(QString(100, QChar::Nbsp));
-            qmesg.setText(text);
-            QString informativeText = QObject::tr("Error message:");
-            qmesg.setWindowTitle(title);
-            qmesg.setDetailedText(cleartextString);
-            qmesg.setIcon(QMessageBox::Warning);
-            qmesg.setSizeGripEnabled(true);
-            qmesg.exec();
+            GuiHelper::warningWithDetails(title, text, cleartextString);
         } else {
-            qmesg.warning(nullptr, title, cleartextString);
+            GuiHelper::warning(title, cleartextString);
         }
 
     }
 }
 
+// Explain that the dynamic loader ElfPreflight has looked for is missing; missing
+// libraries are left to the loader and reported by handleError()
+void Launcher::reportMissingInterpreter(const ElfPreflight::Result &preflight, const QString &title)
+{
+    qDebug() << "# Missing" << preflight.library << "required by" << preflight.requiredBy;
+    reportError(QString("%1 cannot be started because %2 is missing.")
+                        .arg(title)
+                        .arg(preflight.library),
+                title);
+}
+
+bool Launcher::isFatalErrorLine(const QByteArray &line)
+{
+    return ErrorRules::instance().isFatalLine(line);
+}
+
+int Launcher::errorWindowMsecs()
+{
+    bool ok = false;
+    double seconds = qEnvironmentVariable("LAUNCH_ERROR_WINDOW").toDouble(&ok);
+    if (!ok || seconds < 0)
+        return 10 * 1000;
+    return int(qMin(seconds, 24 * 60 * 60.0) * 1000);
+}
+
+// Show why an application has failed early, and tell Menu that it is no more being launched
+void Launcher::reportApplicationFailure(const QString &program, const QString &name,
+                                        int exitCode, QString error)
+{
+    if (error.isEmpty()) {
+        error = QString("%1 exited unexpectedly\nwith exit code %2")
+                        .arg(name)
+                        .arg(exitCode);
+    }
+
+    qDebug() << error;
+    handleError(program, error);
+
+    // Tell Menu that an application is no more being launched
+    MenuNotifier::hideApplicationName();
+}
+
 // Find apps on well-known paths and put them into launch.db
 void Launcher::discoverApplications()
 {
     // Measure the time it takes to look up candidates
     QElapsedTimer timer;
     timer.start();
-    AppDiscovery *ad = new AppDiscovery(db);
+    discovered.start();
+    AppDiscovery *ad = new AppDiscovery(database());
     QStringList wellKnownLocs = ad->wellKnownApplicationLocations();
     ad->findAppsInside(wellKnownLocs);
+    const QString stamp = discoveryStampPath();
+    QDir().mkpath(QFileInfo(stamp).path());
+    QFile stampFile(stamp);
+    if (stampFile.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        stampFile.close(); // Only its modification time matters
     // Print to stdout how long it took to discover applications
     qDebug() << "Took" << timer.elapsed()
              << "milliseconds to discover applications and add them to "
@@ -151,6 +241,21 @@ void Launcher::discoverApplications()
     // ad->~AppDiscovery(); // FIXME: Doing this here would lead to a crash; why?
 }
 
+// Where the %f or %u field code of an Exec line argument is, which may also be
+// part of a longer argument such as "--file=%f"; -1 if there is none. "%%" is a
+// literal percent sign
+static int singleFileFieldCode(const QString &argument)
+{
+    for (int i = 0; i + 1 < argument.length(); i++) {
+        if (argument[i] != '%')
+            continue;
+        if (argument[i + 1] == 'f' || argument[i + 1] == 'u')
+            return i;
+        i++; // Skip the character after the percent sign, e.g., the second one of "%%"
+    }
+    return -1;
+}
+
 QStringList Launcher::executableForBundleOrExecutablePath(QString bundleOrExecutablePath)
 {
     QStringList executableAndArgs = {};
@@ -183,22 +288,19 @@ QStringList Launcher::executableForBundleOrExecutablePath(QString bundleOrExecut
             QStringList execStringAndArgs = QProcess::splitCommand(
                     s); // This should hopefully treat quoted strings halfway correctly
             if (execStringAndArgs.first().count(QLatin1Char('\\')) > 0) {
-                QMessageBox::warning(nullptr, " ",
-                                     "Launching such complex .desktop files is not supported yet.\n"
-                                             + bundleOrExecutablePath);
-                exit(1);
+                reportError("Launching such complex .desktop files is not supported yet.\n"
+                            + bundleOrExecutablePath);
+                return {};
             } else {
                 // Get the first element of the list, which is the executable, and look it up on the $PATH
                 QString executable = execStringAndArgs.first();
                 if (! executable.contains("/")) {
                     QString executablePath = QStandardPaths::findExecutable(executable);
                     if (executablePath == "") {
-                        QMessageBox::warning(nullptr,
-                                             QApplication::tr("Executable not found"),
-                                             QApplication::tr("Could not find executable %1 on $PATH.\n%2")
-                                                 .arg(executable, bundleOrExecutablePath));
-
-                        exit(1);
+                        reportError(QObject::tr("Could not find executable %1 on $PATH.\n%2")
+                                            .arg(executable, bundleOrExecutablePath),
+                                    QObject::tr("Executable not found"));
+                        return {};
                     }
                     // Replace the first element of the list with the full path to the executable
                     execStringAndArgs.replace(0, executablePath);
@@ -212,12 +314,10 @@ QStringList Launcher::executableForBundleOrExecutablePath(QString bundleOrExecut
                     executableAndArgs = QStringList({ bundleOrExecutablePath });
                 } else {
                     qDebug() << "# Found non-executable" << bundleOrExecutablePath;
-                    bool success = Executable::askUserToMakeExecutable(bundleOrExecutablePath);
-                    if (!success) {
-                        exit(1);
-                    } else {
-                        executableAndArgs = QStringList({ bundleOrExecutablePath });
+                    if (!ensureExecutable(bundleOrExecutablePath)) {
+                        return {};
                     }
+                    executableAndArgs = QStringList({ bundleOrExecutablePath });
                 }
             }
         }
@@ -238,16 +338,16 @@ QString Launcher::pathWithoutBundleSuffix(QString path)
     return cleanedPath;
 }
 
-int Launcher::launch(QStringList args)
+LaunchPlan Launcher::plan(QStringList args)
 {
-    QDetachableProcess p;
+    LaunchPlan plan;
+    lastError.clear();
 
     QString executable = nullptr;
     QString firstArg = args.first();
     qDebug() << "launch firstArg:" << firstArg;
 
     QFileInfo fileInfo = QFileInfo(firstArg);
-    QString nameWithoutSuffix = QFileInfo(fileInfo.completeBaseName()).fileName();
 
     // Remove trailing slashes
     while (firstArg.endsWith("/")) {
@@ -273,12 +373,14 @@ int Launcher::launch(QStringList args)
             QFileInfo info = QFileInfo(executable);
             if(! info.isExecutable()) {
                 qDebug() << "# Found non-executable" << executable;
-                bool success = Executable::askUserToMakeExecutable(executable);
-                if (!success) {
-                    exit(1);
+                if (!ensureExecutable(executable)) {
+                    return plan;
                 }
             }
         }
+    } else if (!lastError.isEmpty()) {
+        // Something was found at the path but it can't be launched
+        return plan;
     }
 
     // Second, try to find an executable file on the $PATH
@@ -305,39 +407,51 @@ int Launcher::launch(QStringList args)
 
         QFileInfoList candidates;
 
-        QStringList allAppsFromDb = db->allApplications();
-
-        for (QString appBundleCandidate : allAppsFromDb) {
-            // Now that we may have collected different candidates, decide on which
-            // one to use e.g., the one with the highest self-declared version number.
-            // Also we need to check whether the appBundleCandidate exist
-            // For now, just use the first one
-            if (pathWithoutBundleSuffix(appBundleCandidate).endsWith(firstArg)) {
-                if (QFileInfo(appBundleCandidate).exists()) {
-                    qDebug() << "Selected from launch.db:" << appBundleCandidate;
-                    selectedBundle = appBundleCandidate;
-                    break;
-                } else {
-                    db->handleApplication(appBundleCandidate); // Remove from launch.db it
-                                                               // if it does not exist
+        ensureDiscovered();
+        // An application installed since the last discovery is only found by
+        // discovering again; rediscover() limits how often this happens
+        do {
+            QStringList allAppsFromDb = database()->allApplications();
+
+            for (QString appBundleCandidate : allAppsFromDb) {
+                // Now that we may have collected different candidates, decide on which
+                // one to use e.g., the one with the highest self-declared version number.
+                // Also we need to check whether the appBundleCandidate exist
+                // For now, just use the first one
+                if (pathWithoutBundleSuffix(appBundleCandidate).endsWith(firstArg)) {
+                    if (QFileInfo(appBundleCandidate).exists()) {
+                        qDebug() << "Selected from launch.db:" << appBundleCandidate;
+                        selectedBundle = appBundleCandidate;
+                        break;
+                    } else {
+                        database()->handleApplication(appBundleCandidate); // Remove from launch.db
+                                                                           // if it does not exist
+                    }
                 }
             }
-        }
+        } while (selectedBundle.isEmpty() && rediscover());
 
         // For the selectedBundle, get the launchable executable
         if (selectedBundle == "") {
-            QMessageBox::warning(nullptr, " ",
-                                 QString("The application '%1'\ncan't be launched "
-                                         "because it can't be found.")
-                                         .arg(firstArg));
+            reportError(QString("The application '%1'\ncan't be launched "
+                                "because it can't be found.")
+                                .arg(firstArg));
             // Remove the application from launch.db if the symlink points to a non-existing file
-            db->handleApplication(firstArg);
+            database()->handleApplication(firstArg);
 
-            exit(1);
+            return plan;
         } else {
             QStringList e = executableForBundleOrExecutablePath(selectedBundle);
-            if (e.length() > 0)
+            if (e.length() > 0) {
                 executable = e.first();
+            } else {
+                if (lastError.isEmpty()) {
+                    reportError(QString("The application '%1'\ncan't be launched "
+                                        "because its executable can't be found.")
+                                        .arg(selectedBundle));
+                }
+                return plan;
+            }
         }
     }
 
@@ -351,9 +465,12 @@ int Launcher::launch(QStringList args)
     if (execLinePartsFromDesktopFile.length() > 1) {
         execLinePartsFromDesktopFile.pop_front();
         for (const QString &execLinePartFromDesktopFile : execLinePartsFromDesktopFile) {
-            if (execLinePartFromDesktopFile == "%f" || execLinePartFromDesktopFile == "%u") {
+            const int fieldCode = singleFileFieldCode(execLinePartFromDesktopFile);
+            if (fieldCode >= 0) {
+                // Also within an argument, e.g., "--file=%f"
                 if (args.length() > 0) {
-                    constructedArgs.append(args[0]);
+                    constructedArgs.append(
+                            QString(execLinePartFromDesktopFile).replace(fieldCode, 2, args[0]));
                 }
             } else if (execLinePartFromDesktopFile == "%F" || execLinePartFromDesktopFile == "%U") {
                 if (args.length() > 0) {
@@ -366,49 +483,113 @@ int Launcher::launch(QStringList args)
         args = constructedArgs;
     }
 
-    // Proceed to launch application
-    p.setProgram(executable);
+    plan.executable = executable;
+    plan.arguments = args;
 
-    QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
     qDebug() << "# Setting LAUNCHED_EXECUTABLE environment variable to" << executable;
-    env.insert("LAUNCHED_EXECUTABLE", executable);
     QFileInfo info = QFileInfo(executable);
 
-    p.setArguments(args);
-
     // Hint: LAUNCHED_EXECUTABLE and LAUNCHED_BUNDLE environment variables
     // can be gotten from X11 windows on FreeBSD with
     // procstat -e $(xprop | grep PID | cut -d " " -f 3)
     qDebug() << "info.canonicalFilePath():" << info.canonicalFilePath();
     qDebug() << "executable:" << executable;
-    env.remove("LAUNCHED_BUNDLE"); // So that nested launches won't leak LAUNCHED_BUNDLE
-                                   // from parent to child application; works
     if (info.dir().absolutePath().toLower().endsWith(".appdir")
         || info.dir().absolutePath().toLower().endsWith(".app")) {
         qDebug() << "# Bundle directory (.app, .AppDir)" << info.dir().canonicalPath();
         qDebug() << "# Setting LAUNCHED_BUNDLE environment variable to it";
-        env.insert("LAUNCHED_BUNDLE",
-                   info.dir().canonicalPath()); // Resolve symlinks so as to show
-                                                // the real location
+        plan.bundle = info.dir().canonicalPath(); // Resolve symlinks so as to show
+                                                  // the real location
     } else if (fileInfo.canonicalFilePath().toLower().endsWith(".appimage")) {
         qDebug() << "# Bundle file (.AppImage)" << fileInfo.canonicalFilePath();
         qDebug() << "# Setting LAUNCHED_BUNDLE environment variable to it";
-        env.insert("LAUNCHED_BUNDLE",
-                   fileInfo.canonicalFilePath()); // Resolve symlinks so as to show
-                                                  // the real location
+        plan.bundle = fileInfo.canonicalFilePath(); // Resolve symlinks so as to show
+                                                    // the real location
     } else if (fileInfo.canonicalFilePath().endsWith(".desktop")) {
         qDebug() << "# Bundle file (.desktop)" << fileInfo.canonicalFilePath();
         qDebug() << "# Setting LAUNCHED_BUNDLE environment variable to it";
-        env.insert("LAUNCHED_BUNDLE",
-                   fileInfo.canonicalFilePath()); // Resolve symlinks so as to show
-                                                  // the real location
+        plan.bundle = fileInfo.canonicalFilePath(); // Resolve symlinks so as to show
+                                                    // the real location
     }
+
+    return plan;
+}
+
+bool Launcher::startDetached(const LaunchPlan &plan, qint64 *pid)
+{
+    if (!plan.isValid()) {
+        return false;
+    }
+
+    Spawner p;
+    p.setProgram(plan.executable);
+    p.setArguments(plan.arguments);
+    p.setProcessEnvironment(plan.environment());
+    qDebug() << "# program:" << p.program();
+    qDebug() << "# args:" << plan.arguments;
+    const LaunchPolicy policy =
+            LaunchPolicy::forApplication(plan.bundle.isEmpty() ? plan.executable : plan.bundle);
+    if (!policy.isEmpty()) {
+        qDebug() << "# Policy:" << policy.toString();
+        p.setPolicy(policy);
+    }
+    Prefetcher::prefetch(plan.bundle.isEmpty() ? plan.executable : plan.bundle);
+    if (!p.startDetached()) {
+        reportError(QString("%1\ncan't be launched.").arg(plan.executable));
+        return false;
+    }
+    const qint64 startedPid = p.pid();
+    if (pid)
+        *pid = startedPid;
+    RunningRegistry::add(plan.bundle, startedPid);
+
+    // Now that the application has been started, add it to the launch.db
+    if (!plan.bundle.isEmpty()) {
+        database()->handleApplication(plan.bundle);
+    }
+    return true;
+}
+
+int Launcher::launch(QStringList args)
+{
+    Spawner p;
+
+    QString firstArg = args.first();
+
+    QFileInfo fileInfo = QFileInfo(firstArg);
+    QString nameWithoutSuffix = QFileInfo(fileInfo.completeBaseName()).fileName();
+
+    // Remove trailing slashes
+    while (firstArg.endsWith("/")) {
+        firstArg.remove(firstArg.length() - 1, 1);
+    }
+
+    LaunchPlan plan;
+    if (!PlanCache::findPlan(args, &plan))
+        plan = this->plan(args);
+    if (!plan.isValid()) {
+        // The reason has already been shown to the user
+        exit(1);
+    }
+    QString executable = plan.executable;
+    args = plan.arguments;
+
+    // Proceed to launch application
+    p.setProgram(executable);
+
+    // LAUNCHED_BUNDLE inherited from our parent is not passed on so that nested
+    // launches won't leak LAUNCHED_BUNDLE from parent to child application
+    QProcessEnvironment env = plan.environment();
+
+    p.setArguments(args);
+
     // qDebug() << "# env" << env.toStringList();
     p.setProcessEnvironment(env);
-    qDebug() << "#  p.processEnvironment():" << p.processEnvironment().toStringList();
+    qDebug() << "#  env:" << env.toStringList();
 
-    p.setProcessChannelMode(
-            QProcess::ForwardedOutputChannel); // Forward stdout onto the main process
+    // stdout goes straight to ours; stderr is collected to be shown in case of an error
+    p.setCaptureStandardError(true);
+    p.setFatalErrorMatcher(&Launcher::isFatalErrorLine);
     qDebug() << "# program:" << p.program();
     qDebug() << "# args:" << args;
 
@@ -424,53 +605,43 @@ int Launcher::launch(QStringList args)
     // does not work reliably for all applictions, e.g.,"launch.html - Falkon"
     // TODO: Remove Menu special case here as soon as we can bring up its Search
     // box with D-Bus
+    // Held from looking for a running instance until ours has been registered, so
+    // that a second request for the same bundle (e.g., an impatient double click)
+    // waits for us and then activates our window instead of starting another instance
+    RunningRegistry::StartLock startLock;
     if (args.length() < 1 && env.contains("LAUNCHED_BUNDLE") && (firstArg != "Menu")) {
-        qDebug() << "# Checking for existing windows";
-        const auto &windows = KWindowSystem::windows();
+        if (!startLock.acquire(env.value("LAUNCHED_BUNDLE"), errorWindowMsecs())) {
+            qDebug() << "# Another launch of" << env.value("LAUNCHED_BUNDLE")
+                     << "is taking too long; launching anyway";
+        }
+        // Only look for windows if the registry knows about a running instance;
+        // the windows are only needed to pick which ones to raise
+        const QList<RunningRegistry::Instance> running =
+                RunningRegistry::instances(env.value("LAUNCHED_BUNDLE"));
         bool foundExistingWindow = false;
-        for (WId wid : windows) {
-
-            QString runningBundle = ApplicationInfo::bundlePathForWId(wid);
-            if (runningBundle == env.value("LAUNCHED_BUNDLE")) {
-                // Check if the user ID which the application is running under is the same user ID as is the current user
-                // This is to avoid bringing to the front windows of other users (e.g., if we want to run as root)
-                // FIXME: Find a way that works on all platforms and takes ~3 lines of code instead of ~20
-                int pid = 0;
-                Display *display = XOpenDisplay(nullptr);
-                Atom type;
-                int format;
-                unsigned long nitems, bytes_after;
-                unsigned char *prop;
-                int status = XGetWindowProperty(display, wid, XInternAtom(display, "_NET_WM_PID", False), 0, 1, False, XA_CARDINAL, &type, &format, &nitems, &bytes_after, &prop);
-                if (status == Success && prop) {
-                    pid = *(unsigned long *)prop;
-                    XFree(prop);
-                }
-                XCloseDisplay(display);
-                qDebug() << "# _NET_WM_PID:" << pid;
-                QProcess process;
-                process.start("ps", QStringList() << "-p" << QString::number(pid) << "-o" << "user");
-                process.waitForFinished(-1);
-                QString processOutput = process.readAllStandardOutput();
-                if (processOutput.split("\n").at(1) != qgetenv("USER")) {
-                    qDebug() << "# Not activating window" << wid << "because it is running under a different user ID";
-                    continue;
-                }
-            
-                foundExistingWindow = true;
-                KWindowSystem::forceActiveWindow(wid);
+        bool startingInstance = false;
+        if (!running.isEmpty()) {
+            qDebug() << "# Checking for existing windows of" << running.size() << "instances";
+            QList<qint64> pids;
+            const qint64 now = QDateTime::currentMSecsSinceEpoch();
+            for (const RunningRegistry::Instance &instance : running) {
+                pids.append(instance.pid);
+                // Started so recently that it may not have mapped a window yet
+                if (now - instance.registeredMsecs < errorWindowMsecs())
+                    startingInstance = true;
             }
+            // Only briefly; some applications never map a window, and then a
+            // new instance is better than nothing happening at all
+            foundExistingWindow = GuiHelper::activateWindowsOfBundle(
+                    env.value("LAUNCHED_BUNDLE"), pids,
+                    startingInstance ? StartingInstanceWaitMsecs : 0);
         }
         if (foundExistingWindow) {
             qDebug() << "# Activated existing windows instead of launching a new instance";
-
-            // We can't exit immediately or else te windows won't become active;
-            // FIXME: Do this properly
-            QTime dieTime = QTime::currentTime().addSecs(1);
-            while (QTime::currentTime() < dieTime)
-                QCoreApplication::processEvents(QEventLoop::AllEvents, 100);
-
             exit(0);
+        } else if (startingInstance) {
+            qDebug() << "# The instance of" << env.value("LAUNCHED_BUNDLE")
+                     << "that is still starting has no window yet; launching another one";
         } else {
             qDebug() << "# Did not find existing windows for LAUNCHED_BUNDLE"
                      << env.value("LAUNCHED_BUNDLE");
@@ -482,14 +653,63 @@ int Launcher::launch(QStringList args)
         qDebug() << "# Not checking for existing windows";
     }
 
-    // Start new process
-    p.start();
+    // Have the disk read what the application needed last time while it is being
+    // started, rather than one page fault at a time
+    const QString prefetchKey = plan.bundle.isEmpty() ? plan.executable : plan.bundle;
+    if (execInPlace)
+        Prefetcher::prefetchNow(prefetchKey);
+    else
+        Prefetcher::prefetch(prefetchKey);
+
+    // A handed off application gets its policy from the supervisor
+    const LaunchPolicy policy = LaunchPolicy::forApplication(prefetchKey);
+    if (!policy.isEmpty())
+        qDebug() << "# Policy:" << policy.toString();
+    p.setPolicy(policy);
+
+    // Find missing libraries before starting anything, rather than waiting for
+    // the dynamic loader to fail in the started process. Only a missing loader is
+    // certain; the loader may still find a library the preflight has not, e.g.,
+    // in a directory built into it, so then the application is started anyway and
+    // a real failure is reported from its stderr like before
+    ElfPreflight::Result preflight =
+            ElfPreflight::check(plan.executable, env.value("LD_LIBRARY_PATH"));
+    if (preflight.problem == ElfPreflight::MissingInterpreter) {
+        reportMissingInterpreter(preflight, nameWithoutSuffix);
+        exit(1);
+    } else if (preflight.problem != ElfPreflight::NoProblem) {
+        qDebug() << "# Preflight found" << preflight.library << preflight.version
+                 << "missing for" << preflight.requiredBy << "- starting anyway";
+    }
 
-    // Tell Menu that an application is being launched
-    QString bPath = ApplicationInfo::bundlePath(p.program());
+    // Become the application instead of waiting for it, so that no launcher
+    // process stays around per running application. Nobody is left to show
+    // errors or to tell Menu when the application fails, so do neither
+    if (execInPlace) {
+        if (env.contains("LAUNCHED_BUNDLE")) {
+            database()->handleApplication(env.value("LAUNCHED_BUNDLE"));
+            // The start time of a process stays the same across execve()
+            RunningRegistry::add(env.value("LAUNCHED_BUNDLE"), getpid());
+        }
+        delete db;
+        db = nullptr;
+        qDebug() << "# Executing in place";
+    }
 
-    // Blocks until process has started
-    if (!p.waitForStarted()) {
+    // If a supervisor ('launch --supervise') is running, let it start the application
+    // and watch it for errors so that we can exit right away
+    int handOffError = 0;
+    bool handedOff = !execInPlace && Supervisor::handOff(plan, &handOffError);
+
+    // Start new process; returns once it has been executed or has failed to be.
+    // execInPlace() only returns if it has failed
+    bool started;
+    if (handedOff) {
+        started = (handOffError == 0);
+    } else {
+        started = execInPlace ? p.execInPlace() : p.start();
+    }
+    if (!started) {
         // The reason we ended up here may well be that the file has executable permissions despite
         // it not being an executable file, hence we can't launch it. So we try to open it with its
         // default application
@@ -499,6 +719,15 @@ int Launcher::launch(QStringList args)
         open(completeArgs);
         exit(0);
     }
+    if (!handedOff) {
+        RunningRegistry::add(env.value("LAUNCHED_BUNDLE"), p.pid());
+    }
+    // The supervisor has registered the instance before replying to us
+    startLock.release();
+    if (startedFd >= 0) {
+        close(startedFd);
+        startedFd = -1;
+    }
 
     if (env.value("LAUNCHED_BUNDLE") != "") {
         QString stringToBeDisplayed = QFileInfo(env.value("LAUNCHED_BUNDLE")).completeBaseName();
@@ -508,77 +737,62 @@ int Launcher::launch(QStringList args)
             stringToBeDisplayed = desktopFile.value("Desktop Entry/Name").toString();
         }
 
-        if (QDBusConnection::sessionBus().isConnected()) {
-            QDBusInterface iface("local.Menu", "/", "", QDBusConnection::sessionBus());
-            if (!iface.isValid()) {
-                qDebug() << "D-Bus interface not valid";
-            } else {
-                QDBusReply<QString> reply = iface.call("showApplicationName", stringToBeDisplayed);
-                if (!reply.isValid()) {
-                    qDebug() << "D-Bus reply not valid";
-                } else {
-                    qDebug() << QString("D-Bus reply: %1\n").arg(reply.value());
-                }
-            }
-        }
+        MenuNotifier::showApplicationName(stringToBeDisplayed);
     }
 
-    p.waitForFinished(10
-                      * 1000); // Blocks until process has finished or timeout occured (x seconds)
-    // Errors occuring thereafter will not be reported to the user in a message
-    // box anymore. This should cover most errors like missing libraries, missing
-    // interpreters, etc.
-
-    if (p.state() == 0 and p.exitCode() != 0) {
-        qDebug("Process is not running anymore and exit code was not 0");
-        QString error = p.readAllStandardError();
-        if (error.isEmpty()) {
-            error = QString("%1 exited unexpectedly\nwith exit code %2")
-                            .arg(nameWithoutSuffix)
-                            .arg(p.exitCode());
-        }
-
-        qDebug() << error;
-        handleError(&p, error);
-
-        // Tell Menu that an application is no more being launched
-        if (QDBusConnection::sessionBus().isConnected()) {
-            QDBusInterface iface("local.Menu", "/", "", QDBusConnection::sessionBus());
-            if (!iface.isValid()) {
-                qDebug() << "D-Bus interface not valid";
-            } else {
-                QDBusReply<QString> reply = iface.call("hideApplicationName");
-                if (!reply.isValid()) {
-                    qDebug() << "D-Bus reply not valid";
-                } else {
-                    qDebug() << QString("D-Bus reply: %1\n").arg(reply.value());
-                }
-            }
+    if (handedOff) {
+        qDebug() << "# Handed off to the supervisor";
+        if (env.contains("LAUNCHED_BUNDLE")) {
+            database()->handleApplication(env.value("LAUNCHED_BUNDLE"));
         }
+        MenuNotifier::flush();
+        return 0;
+    }
 
+    // Blocks until the process has finished, has written a known fatal error to
+    // stderr, or the error window is over. Errors occuring thereafter will not be
+    // reported to the user in a message box anymore. This should cover most errors
+    // like missing libraries, missing interpreters, etc.
+    p.waitForFinished(errorWindowMsecs());
+
+    if (p.hasFatalError() || (!p.isRunning() and p.exitCode() != 0)) {
+        qDebug("Process has failed");
+        reportApplicationFailure(p.program(), nameWithoutSuffix, p.exitCode(),
+                                 p.readAllStandardError());
+        // The message is out already; the application may still take a while to give up
+        p.setLogStandardError(nameWithoutSuffix);
+        p.setForwardStandardError(true);
+        p.waitForFinished(-1);
+        RunningRegistry::remove(p.pid());
         exit(p.exitCode());
     }
 
+    // By now the application has loaded what it needs to start up
+    if (p.isRunning())
+        Prefetcher::record(prefetchKey, p.pid());
+
     // When we have made it all the way to here, add our application to the
     // launch.db
     // TODO: Similarly, when we are trying to launch the bundle but it is not
     // there anymore, then remove it from the launch.db
     if (env.contains("LAUNCHED_BUNDLE")) {
-        db->handleApplication(env.value("LAUNCHED_BUNDLE"));
+        database()->handleApplication(env.value("LAUNCHED_BUNDLE"));
     }
 
-    db->~DbManager();
+    delete db;
+    db = nullptr;
 
+    // Keep draining stderr so that the application does not block on a full pipe,
+    // and keep it in a log named by application and PID for a crash reporter
+    p.setLogStandardError(nameWithoutSuffix);
+    p.setForwardStandardError(true);
     p.waitForFinished(-1);
+    RunningRegistry::remove(p.pid());
 
     // Is this a way to p.detach(); and return(0)
     // without crashing the payload application
     // when it writes to stderr?
     // https://github.com/helloSystem/launch/issues/4
-    // TODO: Make these picked up by a crash reporter; maybe name them with the
-    // pid? p.setStandardErrorFile("/tmp/launch_error");
-    // p.setStandardOutputFile("/tmp/launch_output");
-    // p.setInputChannelMode(QProcess::ManagedInputChannel); // "Unforward"
 
     // NOTE: 'daemon launch ...' will lead to '<defunct>' in 'ps ax' output
     // after the following runs; does this have any negative impact other than
@@ -596,7 +810,317 @@ int Launcher::open(QStringList args)
         showChooserRequested = true;
     }
 
-    QString firstArg = args.first();
+    QStringList errors;
+    const QList<QStringList> requests = launchRequestsForDocuments(args, showChooserRequested,
+                                                                   &errors);
+    if (requests.isEmpty()) {
+        // Errors have already been shown to the user; cancelling the chooser is not an error
+        exit(errors.isEmpty() ? 0 : 1);
+    }
+
+    // TODO: Prioritize which of the applications that can handle this
+    // file should get to open it. For now we ust just the first one we find
+    // Errors about other documents have been shown already
+    if (requests.size() == 1)
+        return launch(requests.first());
+    const int result = launchAll(requests);
+    return errors.isEmpty() ? result : 1;
+}
+
+QList<QStringList> Launcher::launchRequestsForDocuments(const QStringList &documents,
+                                                        bool showChooserRequested,
+                                                        QStringList *errors)
+{
+    QList<QStringList> requests;
+    // Which request collects the documents for an application
+    QHash<QString, int> requestForApplication;
+    QHash<QString, QString> handlers;
+    for (int i = 0; i < documents.size(); i++) {
+        const QString &path = documents.at(i);
+        QString document = path;
+        QString application;
+        if (showChooserRequested || !PlanCache::findApplication(path, &application, &document))
+            application = applicationForDocument(document, showChooserRequested, &handlers);
+        if (application.isEmpty()) {
+            // An empty error means that the user has cancelled the chooser
+            if (errors && !lastError.isEmpty())
+                errors->append(lastError);
+            continue;
+        }
+
+        // Executables and .desktop files are launched rather than opened. As the
+        // first argument, one gets the remaining ones as its arguments, so that
+        // 'open ./script arg1' keeps meaning what it always has
+        if (application == document) {
+            if (i == 0) {
+                requests.append(QStringList({ document }) + documents.mid(1));
+                return requests;
+            }
+            requests.append({ document });
+            continue;
+        }
+
+        const auto existing = requestForApplication.constFind(application);
+        if (existing != requestForApplication.constEnd()) {
+            requests[existing.value()].append(document);
+            continue;
+        }
+        if (acceptsMultipleDocuments(application))
+            requestForApplication.insert(application, requests.size());
+        requests.append({ application, document });
+    }
+    return requests;
+}
+
+bool Launcher::acceptsMultipleDocuments(const QString &application)
+{
+    // Bundles and executables get all documents as arguments; .desktop files
+    // with %f or %u take only one
+    if (!application.endsWith(".desktop"))
+        return true;
+    QSettings desktopFile(application, QSettings::IniFormat);
+    const QStringList execLine =
+            QProcess::splitCommand(desktopFile.value("Desktop Entry/Exec").toString());
+    for (const QString &argument : execLine) {
+        if (singleFileFieldCode(argument) >= 0)
+            return false;
+    }
+    return true;
+}
+
+// The 'launch' installed next to us, or the one on the $PATH
+static QString launchExecutablePath()
+{
+    QString launchExecutable = QCoreApplication::applicationDirPath() + "/launch";
+    if (!QFileInfo(launchExecutable).isExecutable())
+        launchExecutable = QStandardPaths::findExecutable("launch");
+    return launchExecutable;
+}
+
+bool Launcher::startLaunch(const QStringList &request)
+{
+    // Resolved here, so that errors in the request can be returned and the
+    // 'launch' does not have to resolve it again
+    LaunchPlan plan;
+    if (!PlanCache::findPlan(request, &plan)) {
+        plan = this->plan(request);
+        if (!plan.isValid())
+            return false;
+        PlanCache::storePlan(request, plan);
+    }
+
+    const QString launchExecutable = launchExecutablePath();
+    if (launchExecutable.isEmpty()) {
+        reportError("'launch' can't be found.");
+        return false;
+    }
+    Spawner p;
+    p.setProgram(launchExecutable);
+    p.setArguments(request);
+    qDebug() << "# Starting" << launchExecutable << request;
+    if (!p.startDetached()) {
+        reportError(QString("%1\ncan't be launched.").arg(plan.executable));
+        return false;
+    }
+    return true;
+}
+
+int Launcher::launchAll(const QList<QStringList> &requests)
+{
+    // Each application gets a 'launch' of its own that watches it for errors
+    const QString launchExecutable = launchExecutablePath();
+    if (launchExecutable.isEmpty()) {
+        reportError("'launch' can't be found.");
+        return 1;
+    }
+
+    // Only so many are started at the same time, so that opening hundreds of
+    // documents with an application that takes one at a time does not bring
+    // the system to a halt. A 'launch' has finished starting when it closes
+    // the write end of its pipe, which happens at the latest when it exits
+    const int maxParallel = qMax(2, QThread::idealThreadCount());
+    std::vector<int> starting;
+    int result = 0;
+    auto waitForOne = [&starting]() {
+        std::vector<struct pollfd> fds;
+        for (int fd : starting)
+            fds.push_back({ fd, POLLIN, 0 });
+        while (poll(fds.data(), nfds_t(fds.size()), -1) < 0 && errno == EINTR) {
+        }
+        for (const struct pollfd &fd : fds) {
+            if (fd.revents != 0) {
+                close(fd.fd);
+                starting.erase(std::find(starting.begin(), starting.end(), fd.fd));
+            }
+        }
+    };
+
+    for (const QStringList &request : requests) {
+        if (int(starting.size()) >= maxParallel)
+            waitForOne();
+
+        // Resolved here already, so that the 'launch' does not have to do it again
+        LaunchPlan plan = this->plan(request);
+        if (!plan.isValid()) {
+            result = 1;
+            continue;
+        }
+        PlanCache::storePlan(request, plan);
+
+        int startedPipe[2];
+        if (pipe2(startedPipe, O_CLOEXEC) != 0) {
+            result = 1;
+            continue;
+        }
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert("LAUNCH_STARTED_FD", QString::number(startedPipe[1]));
+        Spawner p;
+        p.setProgram(launchExecutable);
+        p.setArguments(request);
+        p.setProcessEnvironment(env);
+        p.setInheritedFd(startedPipe[1]);
+        qDebug() << "# Starting" << launchExecutable << request;
+        if (!p.start()) {
+            reportError(QString("%1\ncan't be launched.").arg(plan.executable));
+            result = 1;
+            close(startedPipe[0]);
+        } else {
+            starting.push_back(startedPipe[0]);
+        }
+        close(startedPipe[1]);
+    }
+    while (!starting.empty())
+        waitForOne();
+    // The 'launch' processes keep watching their applications after we have exited
+    return result;
+}
+
+int Launcher::prepare(QStringList args, bool forOpen)
+{
+    // Whatever goes wrong is shown by the launch or open that follows, if any
+    const bool wasInteractive = interactive;
+    interactive = false;
+
+    QStringList request = args;
+    if (forOpen) {
+        QString document = args.first();
+        QString application = applicationForDocument(document);
+        if (application.isEmpty()) {
+            interactive = wasInteractive;
+            return 1;
+        }
+        PlanCache::storeApplication(args.first(), application, document);
+        // What open() will pass to launch()
+        if (application == document)
+            request.replace(0, document);
+        else
+            request = QStringList({ application, document });
+    }
+
+    LaunchPlan plan = this->plan(request);
+    interactive = wasInteractive;
+    if (!plan.isValid())
+        return 1;
+    PlanCache::storePlan(request, plan);
+
+    // The preflight reads the headers of all libraries, so it goes last
+    Prefetcher::prefetchFile(plan.executable);
+    Prefetcher::prefetchNow(plan.bundle.isEmpty() ? plan.executable : plan.bundle);
+    ElfPreflight::check(plan.executable, plan.environment().value("LD_LIBRARY_PATH"));
+    qDebug() << "# Prepared" << plan.executable << plan.arguments;
+    return 0;
+}
+
+// Returns false at the end of input
+static bool readBatchRequest(FILE *input, bool nullSeparated, QStringList *request)
+{
+    request->clear();
+    const int delimiter = nullSeparated ? '\0' : '\n';
+    char *line = nullptr;
+    size_t capacity = 0;
+    ssize_t length;
+    while ((length = getdelim(&line, &capacity, delimiter, input)) >= 0) {
+        if (length > 0 && line[length - 1] == delimiter)
+            length--;
+        if (!nullSeparated) {
+            *request = QProcess::splitCommand(QString::fromLocal8Bit(line, int(length)));
+            if (!request->isEmpty())
+                break; // Blank lines are skipped
+        } else if (length > 0) {
+            request->append(QString::fromLocal8Bit(line, int(length)));
+        } else if (!request->isEmpty()) {
+            break;
+        }
+    }
+    free(line);
+    return !request->isEmpty();
+}
+
+static void writeBatchResult(FILE *output, const QStringList &request, const QStringList &errors,
+                             const QList<qint64> &pids, const QStringList &executables)
+{
+    QJsonObject result;
+    result.insert("request", QJsonArray::fromStringList(request));
+    result.insert("status", errors.isEmpty() ? "ok" : "error");
+    if (!errors.isEmpty())
+        result.insert("error", errors.join('\n'));
+    QJsonArray pidArray;
+    for (qint64 pid : pids)
+        pidArray.append(pid);
+    result.insert("pids", pidArray);
+    result.insert("executables", QJsonArray::fromStringList(executables));
+    const QByteArray line = QJsonDocument(result).toJson(QJsonDocument::Compact) + '\n';
+    fwrite(line.constData(), 1, size_t(line.size()), output);
+    fflush(output);
+}
+
+int Launcher::batch(FILE *input, FILE *output, bool forOpen, bool nullSeparated)
+{
+    // There is nobody to click away dialogs in a script
+    const bool wasInteractive = interactive;
+    interactive = false;
+
+    int result = 0;
+    QStringList request;
+    while (readBatchRequest(input, nullSeparated, &request)) {
+        QStringList errors, executables;
+        QList<qint64> pids;
+        QList<QStringList> launchRequests;
+        if (forOpen)
+            launchRequests = launchRequestsForDocuments(request, false, &errors);
+        else
+            launchRequests.append(request);
+
+        for (const QStringList &launchRequest : launchRequests) {
+            LaunchPlan plan;
+            if (!PlanCache::findPlan(launchRequest, &plan))
+                plan = this->plan(launchRequest);
+            qint64 pid = 0;
+            if (!plan.isValid() || !startDetached(plan, &pid)) {
+                errors.append(lastError.isEmpty()
+                                      ? QString("'%1' can't be launched.").arg(launchRequest.first())
+                                      : lastError);
+                continue;
+            }
+            pids.append(pid);
+            executables.append(plan.executable);
+        }
+
+        writeBatchResult(output, request, errors, pids, executables);
+        if (!errors.isEmpty())
+            result = 1;
+    }
+
+    interactive = wasInteractive;
+    return result;
+}
+
+QString Launcher::applicationForDocument(QString &document, bool showChooserRequested,
+                                         QHash<QString, QString> *handlers)
+{
+    lastError.clear();
+
+    QString firstArg = document;
     qDebug() << "open firstArg:" << firstArg;
 
     // Workaround for FreeBSD not being able to properly mount all AppImages
@@ -612,8 +1136,7 @@ int Launcher::open(QStringList args)
             if (firstArg.toLower().endsWith(".appimage")) {
                 QFileInfo info = QFileInfo(firstArg);
                 if (!info.isExecutable()) {
-                    args.insert(0, runappimage);
-                    firstArg = args.first();
+                    return runappimage;
                 }
             }
         }
@@ -629,36 +1152,29 @@ int Launcher::open(QStringList args)
         if (QFileInfo(firstArg).isSymLink()) {
             // Broken symlink
             // TODO: Offer to delete or fix broken symlinks
-            QMessageBox::warning(nullptr, " ",
-                                 QString("The symlink '%1'\ncan't be opened "
-                                         "because\nthe target '%2'\ncan't be found.")
-                                         .arg(firstArg)
-                                         .arg(QFileInfo(firstArg).symLinkTarget()));
+            reportError(QString("The symlink '%1'\ncan't be opened "
+                                "because\nthe target '%2'\ncan't be found.")
+                                .arg(firstArg)
+                                .arg(QFileInfo(firstArg).symLinkTarget()));
         } else {
             // File not found
-            QMessageBox::warning(
-                    nullptr, " ",
-                    QString("'%1'\ncan't be opened because it can't be found.").arg(firstArg));
+            reportError(QString("'%1'\ncan't be opened because it can't be found.").arg(firstArg));
         }
-        exit(1);
+        return QString();
     }
 
     // Check whether the file to be opened is an ELF executable or a script missing the executable bit
     if(!showChooserRequested && Executable::hasShebangOrIsElf(firstArg)) {
-        QStringList executableAndArgs;
         QFileInfo info = QFileInfo(firstArg);
         if(info.isExecutable()) {
             qDebug() << "# Found executable" << firstArg;
-            exit(launch(args));
         } else {
             qDebug() << "# Found non-executable" << firstArg;
-            bool success = Executable::askUserToMakeExecutable(firstArg);
-            if (!success) {
-                exit(1);
-            } else {
-                exit(launch(args));
+            if (!ensureExecutable(firstArg)) {
+                return QString();
             }
         }
+        return firstArg;
     }
 
     // Check whether the file to be opened specifies an application it wants to be
@@ -672,7 +1188,7 @@ int Launcher::open(QStringList args)
         // possibly be made more sophisticated by allowing the open-with
         // value to any kind of string that 'launch' knows to open;
         // to be decided. Behavior might change in the future.
-        if (db->applicationExists(openWith)) {
+        if (database()->applicationExists(openWith)) {
             appToBeLaunched = openWith;
         }
     }
@@ -727,25 +1243,32 @@ int Launcher::open(QStringList args)
         QStringList blacklistedMimeTypes = { "application/octet-stream" };
         for (const QString blacklistedMimeType : blacklistedMimeTypes) {
             if ((mimeType == blacklistedMimeType) && (!firstArg.contains(":/"))) {
-                QMessageBox::warning(
-                        nullptr, " ",
-                        QString("Cannot open %1\nof MIME type '%2'.").arg(firstArg, mimeType));
-                exit(1);
+                reportError(QString("Cannot open %1\nof MIME type '%2'.").arg(firstArg, mimeType));
+                return QString();
             }
         }
 
         // Do not open .desktop files; instead, launch them
         if (mimeType == "application/x-desktop") {
-            QStringList argsForLaunch = { firstArg };
-            argsForLaunch.append(args);
-            return launch(argsForLaunch);
+            document = firstArg;
+            return firstArg;
+        }
+
+        // Documents of a type that has already been resolved for the same open go
+        // to the same application, without asking the database or the user again
+        const QString handlerKey = mimeType;
+        bool resolvedBefore = false;
+        if (handlers && handlers->contains(handlerKey)) {
+            appToBeLaunched = handlers->value(handlerKey);
+            resolvedBefore = true;
+            qDebug() << "# Already resolved" << handlerKey << "to" << appToBeLaunched;
         }
 
         // Check whether there is a symlink in ~/.local/share/launch/MIME/<...>/Default
         // pointing to an application that exists on disk; if yes, then use that
-        if (!showChooserRequested) {
+        if (!showChooserRequested && !resolvedBefore) {
             QString mimePath = QString("%1/%2")
-                                       .arg(db->localShareLaunchMimePath)
+                                       .arg(DbManager::localShareLaunchMimePath)
                                        .arg(mimeType.replace("/", "_"));
             QString defaultPath = QString("%1/Default").arg(mimePath);
             if (QFileInfo::exists(defaultPath)) {
@@ -789,35 +1312,42 @@ int Launcher::open(QStringList args)
             QStringList appCandidates;
             QStringList fallbackAppCandidates; // Those where only the first part of
                                                // the MIME type before the "/" matches
-            const QStringList allApps = db->allApplications();
-            for (const QString &app : allApps) {
-
-                QStringList canOpens;
-                if (db->filesystemSupportsExtattr) {
-                    bool ok = false;
-                    canOpens = Fm::getAttributeValueQString(app, "can-open", ok).split(";");
-                    if (!ok) {
-                        if (!removalCandidates.contains(app))
-                            removalCandidates.append(app);
-                        continue;
+            ensureDiscovered();
+            // An application installed since the last discovery is only found by
+            // discovering again; rediscover() limits how often this happens
+            do {
+                appCandidates.clear();
+                fallbackAppCandidates.clear();
+                const QStringList allApps = database()->allApplications();
+                for (const QString &app : allApps) {
+
+                    QStringList canOpens;
+                    if (database()->filesystemSupportsExtattr) {
+                        bool ok = false;
+                        canOpens = Fm::getAttributeValueQString(app, "can-open", ok).split(";");
+                        if (!ok) {
+                            if (!removalCandidates.contains(app))
+                                removalCandidates.append(app);
+                            continue;
+                        }
+                    } else {
+                        canOpens = database()->getCanOpenFromFile(app).split(";");
                     }
-                } else {
-                    canOpens = db->getCanOpenFromFile(app).split(";");
-                }
 
-                for (const QString &canOpen : canOpens) {
-                    if (canOpen == mimeType) {
-                        qDebug() << app << "can open" << canOpen;
-                        if (!appCandidates.contains(app))
-                            appCandidates.append(app);
-                    }
-                    if (canOpen.split("/").first() == mimeType.split("/").first()) {
-                        qDebug() << app << "can open" << canOpen.split("/").first();
-                        if (!fallbackAppCandidates.contains(app))
-                            fallbackAppCandidates.append(app);
+                    for (const QString &canOpen : canOpens) {
+                        if (canOpen == mimeType) {
+                            qDebug() << app << "can open" << canOpen;
+                            if (!appCandidates.contains(app))
+                                appCandidates.append(app);
+                        }
+                        if (canOpen.split("/").first() == mimeType.split("/").first()) {
+                            qDebug() << app << "can open" << canOpen.split("/").first();
+                            if (!fallbackAppCandidates.contains(app))
+                                fallbackAppCandidates.append(app);
+                        }
                     }
                 }
-            }
+            } while (appCandidates.isEmpty() && rediscover());
 
             qDebug() << "appCandidates:" << appCandidates;
 
@@ -836,27 +1366,28 @@ int Launcher::open(QStringList args)
             }
 
             if (showChooserRequested || appCandidates.length() < 1) {
-                ApplicationSelectionDialog *dlg =
-                        new ApplicationSelectionDialog(&fileOrProtocol, &mimeType, true, false, nullptr);
-                auto result = dlg->exec();
-                if (result == QDialog::Accepted)
-                    appToBeLaunched = dlg->getSelectedApplication();
-                else
-                    exit(0);
+                if (!interactive) {
+                    lastError = QString("No application can open '%1'\nof MIME type '%2'.")
+                                        .arg(fileOrProtocol, mimeType);
+                    return QString();
+                }
+                appToBeLaunched = GuiHelper::chooseApplication(fileOrProtocol, mimeType);
+                if (appToBeLaunched.isEmpty())
+                    return QString(); // Cancelled by the user
             } else {
                 appToBeLaunched = appCandidates[0];
             }
             qDebug() << "appToBeLaunched" << appToBeLaunched;
         }
+        if (handlers && !resolvedBefore && !appToBeLaunched.isEmpty())
+            handlers->insert(handlerKey, appToBeLaunched);
     }
     // Garbage collect launch.db: Remove applications that are no longer on the
     // filesystem
     for (const QString removalCandidate : removalCandidates) {
-        db->handleApplication(removalCandidate);
+        database()->handleApplication(removalCandidate);
     }
 
-    // TODO: Prioritize which of the applications that can handle this
-    // file should get to open it. For now we ust just the first one we find
-    // const QStringList arguments = QStringList({appCandidates[0], path});
-    return launch({ appToBeLaunched, firstArg });
+    document = firstArg;
+    return appToBeLaunched;
 }
\ No newline at end of file
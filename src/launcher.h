@@ -1,51 +1,31 @@
 #ifndef LAUNCHER_H
 #define LAUNCHER_H
 
-#include <QApplication>
+#include <QCoreApplication>
 #include <QProcess>
 #include <QDebug>
-#include <QMessageBox>
 #include <QFile>
 #include <QFileInfo>
 #include <QStandardPaths>
 #include <QDirIterator>
 #include <QTime>
+#include <QDateTime>
 #include <QElapsedTimer>
-#include <QRegularExpressionValidator>
-#include <QIcon>
-#include <QStyle>
-#include <QTime>
+#include <QMimeDatabase>
+#include <QRegularExpression>
+#include <QSettings>
 #include <QUrl>
-#include <QTableWidget>
-#include <QLayout>
-#include <QHeaderView>
-#include <QLabel>
-#include <QListWidget>
-#include <QSizePolicy>
-#include <QDialogButtonBox>
-#include <QCheckBox>
 #include <QtDBus/QtDBus>
 
-#include <KF5/KWindowSystem/KWindowSystem>
+#include <stdio.h>
 
 #include "DbManager.h"
 #include "ApplicationInfo.h"
 #include "AppDiscovery.h"
+#include "LaunchPlan.h"
+#include "ElfPreflight.h"
 #include "extattrs.h"
 
-class QDetachableProcess : public QProcess
-
-{
-public:
-    QDetachableProcess(QObject *parent = 0) : QProcess(parent) { }
-    void detach()
-    {
-        this->waitForStarted();
-        setProcessState(QProcess::NotRunning);
-        // qDebug() << "Detaching process";
-    }
-};
-
 class Launcher
 {
 public:
@@ -54,14 +34,86 @@ public:
 
     void discoverApplications();
     int launch(QStringList args);
+    // Open each of args, which are documents, with its application; documents for
+    // the same application are passed to one instance where it accepts several
     int open(const QStringList args);
 
+    // Resolve what would be launched for args without launching it
+    LaunchPlan plan(QStringList args);
+    // Resolve args for a launch or open that is likely to follow, read the files
+    // of the application into the page cache and remember the result for a while
+    // (see PlanCache.h); shows no dialogs. Returns 0 if there is something to launch
+    int prepare(QStringList args, bool forOpen);
+    // Read requests from input until its end and start each without waiting for
+    // it, writing one line of JSON per request to output; shows no dialogs.
+    // Requests are lines split into arguments like a shell would, or with
+    // nullSeparated, NUL-terminated arguments with an empty one after each
+    // request. For open, the arguments of a request are documents. Returns 0
+    // if all requests have succeeded
+    int batch(FILE *input, FILE *output, bool forOpen, bool nullSeparated);
+    // Resolve the application that opens document; may rewrite document,
+    // e.g., "file://" URLs to paths. Returns document itself for executables
+    // and .desktop files, which are launched rather than opened. handlers
+    // remembers the application for each MIME type across calls
+    QString applicationForDocument(QString &document, bool showChooserRequested = false,
+                                   QHash<QString, QString> *handlers = nullptr);
+    // Resolve documents in one pass and group them by application, into what
+    // launch() takes: the application followed by its documents. If the first
+    // document is an executable or .desktop file, the result is the one request
+    // to launch it with the other documents as arguments. Documents that can't
+    // be opened are left out, with what went wrong appended to errors
+    QList<QStringList> launchRequestsForDocuments(const QStringList &documents,
+                                                  bool showChooserRequested = false,
+                                                  QStringList *errors = nullptr);
+    // Start a resolved plan without waiting for it or watching it for errors
+    bool startDetached(const LaunchPlan &plan, qint64 *pid = nullptr);
+    // Resolve request and hand it to a 'launch' process of its own without waiting
+    // for it; that one does everything the command does, from activating a running
+    // instance to showing errors. Returns false if request can't be resolved
+    bool startLaunch(const QStringList &request);
+
+    // Show why an application exited early with exitCode; error is what it wrote to stderr
+    void reportApplicationFailure(const QString &program, const QString &name, int exitCode,
+                                  QString error);
+    // Whether a line an application wrote to stderr is one of the errors handled
+    // with a clear text message; such an error is reported without waiting for the exit
+    static bool isFatalErrorLine(const QByteArray &line);
+    // How long after the start an application that fails is reported, in milliseconds;
+    // 10 seconds unless LAUNCH_ERROR_WINDOW sets the number of seconds
+    static int errorWindowMsecs();
+
+    // When not interactive, no dialogs are shown; errors are only remembered
+    void setInteractive(bool interactive);
+    // Replace the launcher process with the application rather than
+    // waiting for it and watching it for errors
+    void setExecInPlace(bool execInPlace);
+    QString errorString() const;
+
 private:
     DbManager *db;
-    void handleError(QDetachableProcess *p, QString errorString);
+    QElapsedTimer discovered; // Since the last discovery; invalid before the first
+    bool interactive;
+    bool execInPlace;
+    QString lastError;
+    DbManager *database();
+    void ensureDiscovered();
+    bool rediscover();
+    static const int RediscoveryIntervalMsecs = 2000;
+    // How long a second launch waits for a window of an instance that is still starting
+    static const int StartingInstanceWaitMsecs = 3000;
+    void reportError(const QString &message, const QString &title = " ");
+    bool ensureExecutable(const QString &path);
+    void handleError(const QString &program, QString errorString);
+    void reportMissingInterpreter(const ElfPreflight::Result &preflight, const QString &title);
     QString getPackageUpdateCommand(QString pathToInstalledFile);
     QStringList executableForBundleOrExecutablePath(QString bundleOrExecutablePath);
     QString pathWithoutBundleSuffix(QString path);
+    bool acceptsMultipleDocuments(const QString &application);
+    // Start a 'launch' for each request, a few at a time, without waiting for
+    // the applications; for opening documents with several applications
+    int launchAll(const QList<QStringList> &requests);
+    // Where to tell the 'open' that has started us that the application has started
+    int startedFd;
 };
 
 #endif // LAUNCHER_H
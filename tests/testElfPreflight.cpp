@@ -0,0 +1,60 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "ElfPreflight.h"
+
+class TestElfPreflight : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testSystemExecutable() {
+        ElfPreflight::Result result = ElfPreflight::check("/bin/sh", QString());
+        QCOMPARE(result.problem, ElfPreflight::NoProblem);
+        // Now from the cache
+        result = ElfPreflight::check("/bin/sh", QString());
+        QCOMPARE(result.problem, ElfPreflight::NoProblem);
+    }
+
+    void testNotElf() {
+        QTemporaryFile script;
+        QVERIFY(script.open());
+        script.write("#!/bin/sh\nexit 0\n");
+        script.close();
+        QCOMPARE(ElfPreflight::check(script.fileName(), QString()).problem,
+                 ElfPreflight::NoProblem);
+    }
+
+    void testMissingLibrary() {
+        // A copy of /bin/sh that needs "libc.so.X" instead of its libc
+        QFile original("/bin/sh");
+        QVERIFY(original.open(QIODevice::ReadOnly));
+        QByteArray data = original.readAll();
+        int pos = data.indexOf("libc.so.");
+        while (pos >= 0 && (pos + 9 >= data.size() || !isdigit(data.at(pos + 8))))
+            pos = data.indexOf("libc.so.", pos + 1);
+        if (pos < 0)
+            QSKIP("/bin/sh does not link to a versioned libc");
+        data[pos + 8] = 'X';
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QFile broken(dir.filePath("broken"));
+        QVERIFY(broken.open(QIODevice::WriteOnly));
+        broken.write(data);
+        broken.close();
+
+        ElfPreflight::Result result = ElfPreflight::check(broken.fileName(), QString());
+        QCOMPARE(result.problem, ElfPreflight::MissingLibrary);
+        QVERIFY(result.library.startsWith("libc.so.X"));
+
+        // Remembered, with the same result
+        result = ElfPreflight::check(broken.fileName(), QString());
+        QCOMPARE(result.problem, ElfPreflight::MissingLibrary);
+        QVERIFY(result.library.startsWith("libc.so.X"));
+        QCOMPARE(result.requiredBy, broken.fileName());
+    }
+};
+
+QTEST_APPLESS_MAIN(TestElfPreflight)
+
+#include "testElfPreflight.moc"
@@ -0,0 +1,78 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "ErrorOutputBuffer.h"
+
+class TestErrorOutputBuffer : public QObject {
+    Q_OBJECT
+
+private:
+    static void append(ErrorOutputBuffer &buffer, const QByteArray &data) {
+        buffer.append(data.constData(), data.size());
+    }
+
+private slots:
+    void testBelowCapacity() {
+        ErrorOutputBuffer buffer(8, 8);
+        QVERIFY(buffer.isEmpty());
+        append(buffer, "abc\n");
+        QVERIFY(!buffer.isEmpty());
+        QCOMPARE(buffer.contents(), QByteArray("abc\n"));
+    }
+
+    void testExactlyAtCapacity() {
+        // In one piece, the tail is replaced as a whole
+        ErrorOutputBuffer buffer(8, 8);
+        append(buffer, "0123456789abcdef");
+        QCOMPARE(buffer.contents(), QByteArray("0123456789abcdef"));
+
+        // Byte by byte, the tail fills up without wrapping around
+        ErrorOutputBuffer pieces(8, 8);
+        for (char c : QByteArray("0123456789abcdef"))
+            pieces.append(&c, 1);
+        QCOMPARE(pieces.contents(), QByteArray("0123456789abcdef"));
+    }
+
+    void testWraparound() {
+        ErrorOutputBuffer buffer(4, 4);
+        append(buffer, "abcd");
+        append(buffer, "efgh");
+        append(buffer, "ij");
+        QCOMPARE(buffer.contents(), QByteArray("abcd\n[... 2 bytes omitted ...]\nghij"));
+        // Wraps past the end of the ring
+        append(buffer, "klm");
+        QCOMPARE(buffer.contents(), QByteArray("abcd\n[... 5 bytes omitted ...]\njklm"));
+
+        buffer.clear();
+        QVERIFY(buffer.isEmpty());
+        QCOMPARE(buffer.contents(), QByteArray());
+    }
+
+    void testLineAcrossHeadAndTail() {
+        ErrorOutputBuffer buffer(8, 32);
+        buffer.setFatalLineMatcher(
+                [](const QByteArray &line) { return line.startsWith("fatal"); });
+        append(buffer, "abc\nfat");
+        QVERIFY(!buffer.hasFatalLine());
+        append(buffer, "al error\nok\n");
+        QCOMPARE(buffer.contents(), QByteArray("abc\nfatal error\nok\n"));
+        QVERIFY(buffer.hasFatalLine());
+        QCOMPARE(buffer.fatalLine(), QByteArray("fatal error"));
+    }
+
+    void testElisionMarker() {
+        // The marker gets a line of its own even if the head ends within a line
+        ErrorOutputBuffer buffer(6, 6);
+        append(buffer, "first line\nsecond\nlast line\n");
+        QCOMPARE(buffer.contents(), QByteArray("first \n[... 16 bytes omitted ...]\n line\n"));
+
+        // A head that ends with a line is not followed by an empty one
+        ErrorOutputBuffer lines(6, 6);
+        append(lines, "first\nsecond\nlast line\n");
+        QCOMPARE(lines.contents(), QByteArray("first\n[... 11 bytes omitted ...]\n line\n"));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestErrorOutputBuffer)
+
+#include "testErrorOutputBuffer.moc"
@@ -0,0 +1,90 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "ErrorRules.h"
+
+class TestErrorRules : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testLibraryVersion() {
+        ErrorRules rules;
+        ErrorMatch match = rules.match(
+                "/usr/local/lib/libfoo.so.1: no version information available (required by x)\n"
+                "ld-elf.so.1: /usr/local/lib/libbar.so.2: version BAR_1.4 required by /Applications/Foo.app/Foo not found\n");
+        QVERIFY(match.rule);
+        QCOMPARE(match.rule->name, QString("library-version"));
+
+        int lookups = 0;
+        auto noCommand = [&lookups](const QString &path) {
+            lookups++;
+            return path == "/usr/local/lib/libbar.so.2" ? QString() : QString("wrong");
+        };
+        QCOMPARE(ErrorRules::message(match, "Foo", noCommand),
+                 QString("Foo application requires at least version BAR_1.4 of libbar.so.2 to run."
+                         "\n\nPlease update it and try again."));
+        QCOMPARE(lookups, 1);
+
+        auto command = [](const QString &) { return QString("sudo pkg install bar"); };
+        QVERIFY(ErrorRules::message(match, "Foo", command)
+                        .endsWith("Please update it with\nsudo pkg install bar\nand try again."));
+    }
+
+    void testPriority() {
+        // The Chromium sandbox rule comes before the Python module rule, wherever it appears
+        ErrorRules rules;
+        ErrorMatch match = rules.match("ModuleNotFoundError: No module named 'foo'\n"
+                                       "[1:2:setuid_sandbox_host.cc(158)] The SUID sandbox helper binary was found\n");
+        QVERIFY(match.rule);
+        QCOMPARE(match.rule->name, QString("chromium-sandbox"));
+    }
+
+    void testIgnoredLines() {
+        ErrorRules rules;
+        ErrorMatch match = rules.match("ERROR: ld.so: object 'libfoo.so' from LD_PRELOAD cannot be preloaded: ignored.\n"
+                                       "Segmentation fault");
+        QVERIFY(!match.rule);
+        QCOMPARE(match.remainingLines, QStringList { "Segmentation fault" });
+    }
+
+    void testFatalLine() {
+        ErrorRules rules;
+        QVERIFY(rules.isFatalLine("FATAL: kernel too old"));
+        // Often caught for optional modules
+        QVERIFY(!rules.isFatalLine("ModuleNotFoundError: No module named 'PyQt5'"));
+        QVERIFY(!rules.isFatalLine("ModuleNotFoundError: something else"));
+        QVERIFY(!rules.isFatalLine("object 'x' from LD_PRELOAD cannot be preloaded"));
+    }
+
+    void testLoad() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QFile file(dir.filePath("error-rules.conf"));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[missing-display]\n"
+                   "Pattern=\"cannot open display: (.*)\"\n"
+                   "Message=\"{title} cannot open the display {1}, try again later.\"\n"
+                   "[python-module]\n"
+                   "Contains=ModuleNotFoundError\n"
+                   "Message=\"{title} is missing a Python module\"\n");
+        file.close();
+
+        ErrorRules rules;
+        const size_t builtIn = rules.rules().size();
+        rules.load(file.fileName());
+        QCOMPARE(rules.rules().size(), builtIn + 1);
+
+        ErrorMatch match = rules.match("Gtk: cannot open display: :1");
+        QVERIFY(match.rule);
+        QCOMPARE(ErrorRules::message(match, "Foo", [](const QString &) { return QString(); }),
+                 QString("Foo cannot open the display :1, try again later."));
+
+        match = rules.match("ModuleNotFoundError: No module named 'foo'");
+        QCOMPARE(ErrorRules::message(match, "Foo", [](const QString &) { return QString(); }),
+                 QString("Foo is missing a Python module"));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestErrorRules)
+
+#include "testErrorRules.moc"
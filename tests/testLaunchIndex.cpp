@@ -0,0 +1,114 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "ApplicationInfo.h"
+#include "LaunchIndex.h"
+
+class TestLaunchIndex : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir dataHome;
+    QTemporaryDir applications;
+
+    QString makeBundle(const QString &name) {
+        QString path = applications.path() + "/" + name;
+        QDir().mkpath(path);
+        return path;
+    }
+
+private slots:
+    void initTestCase() {
+        QVERIFY(dataHome.isValid());
+        QVERIFY(applications.isValid());
+        qputenv("XDG_DATA_HOME", dataHome.path().toUtf8());
+        QDir().mkpath(LaunchIndex::applicationsPath());
+        QDir().mkpath(LaunchIndex::mimePath() + "text_plain");
+        QDir().mkpath(LaunchIndex::mimePath() + "image_png");
+
+        QString featherPad = makeBundle("FeatherPad.app");
+        QString kate = makeBundle("Kate.AppDir");
+        QVERIFY(QFile::link(featherPad, LaunchIndex::applicationsPath() + "FeatherPad.app"));
+        QVERIFY(QFile::link(kate, LaunchIndex::applicationsPath() + "Kate.AppDir"));
+        QVERIFY(QFile::link(applications.path() + "/Gone.app",
+                            LaunchIndex::applicationsPath() + "Gone.app"));
+        QVERIFY(QFile::link(featherPad, LaunchIndex::mimePath() + "text_plain/FeatherPad.app"));
+        QVERIFY(QFile::link(kate, LaunchIndex::mimePath() + "text_plain/Kate.AppDir"));
+        QVERIFY(QFile::link(kate, LaunchIndex::mimePath() + "image_png/Kate.AppDir"));
+    }
+
+    void testApplications() {
+        LaunchIndex index;
+        QStringList apps = index.applications();
+        QCOMPARE(apps.length(), 2);
+        QVERIFY(apps.first().endsWith("/FeatherPad.app"));
+    }
+
+    void testApplicationForName() {
+        LaunchIndex index;
+        QVERIFY(index.applicationForName("FeatherPad").endsWith("/FeatherPad.app"));
+        QVERIFY(index.applicationForName("Kate.AppDir").endsWith("/Kate.AppDir"));
+        QVERIFY(index.applicationForName("Pad").isEmpty());
+        QVERIFY(index.applicationForName("Gone").isEmpty());
+    }
+
+    void testHandlers() {
+        LaunchIndex index;
+        QCOMPARE(index.handlersForMimeType("text/plain").length(), 2);
+        QVERIFY(index.defaultHandlerForMimeType("text/plain").isEmpty());
+        QVERIFY(index.defaultHandlerForMimeType("image/png").endsWith("/Kate.AppDir"));
+
+        // The cache must notice when the user chooses a default application
+        QVERIFY(QFile::link(applications.path() + "/FeatherPad.app",
+                            LaunchIndex::mimePath() + "text_plain/Default"));
+        QVERIFY(index.defaultHandlerForMimeType("text/plain").endsWith("/FeatherPad.app"));
+        QCOMPARE(index.handlersForMimeType("text/plain").length(), 2);
+    }
+
+    void testDeletedApplicationIsSkipped() {
+        LaunchIndex index;
+        QString doomed = makeBundle("Doomed.app");
+        QVERIFY(QFile::link(doomed, LaunchIndex::applicationsPath() + "Doomed.app"));
+        QCOMPARE(index.applications().length(), 3);
+
+        // Deleting the bundle does not change the directory with the symlinks
+        QVERIFY(QDir(doomed).removeRecursively());
+        QCOMPARE(index.applications().length(), 2);
+        QVERIFY(index.applicationForName("Doomed").isEmpty());
+    }
+
+    void testBundlePathForPId() {
+        QProcessEnvironment env = QProcessEnvironment::systemEnvironment();
+        env.insert("NOT_LAUNCHED_BUNDLE", "/Applications/Wrong.app");
+        env.insert("LAUNCHED_BUNDLE", "/Applications/FeatherPad.app");
+        QProcess launched;
+        launched.setProcessEnvironment(env);
+        launched.start("sleep", { "10" });
+        QVERIFY(launched.waitForStarted());
+        QProcess other;
+        env.remove("LAUNCHED_BUNDLE");
+        other.setProcessEnvironment(env);
+        other.start("sleep", { "10" });
+        QVERIFY(other.waitForStarted());
+
+        const unsigned int launchedPid = unsigned(launched.processId());
+        const unsigned int otherPid = unsigned(other.processId());
+        QCOMPARE(ApplicationInfo::bundlePathForPId(launchedPid), QString("/Applications/FeatherPad.app"));
+        QVERIFY(ApplicationInfo::bundlePathForPId(otherPid).isEmpty());
+
+        QHash<unsigned int, QString> paths =
+                ApplicationInfo::bundlePathsForPIds({ launchedPid, otherPid, launchedPid });
+        QCOMPARE(paths.size(), 2);
+        QCOMPARE(paths.value(launchedPid), QString("/Applications/FeatherPad.app"));
+        QVERIFY(paths.value(otherPid).isEmpty());
+
+        launched.kill();
+        other.kill();
+        launched.waitForFinished();
+        other.waitForFinished();
+    }
+ };
+
+QTEST_APPLESS_MAIN(TestLaunchIndex)
+
+#include "testLaunchIndex.moc"
@@ -0,0 +1,83 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include <sys/resource.h>
+
+#include "LaunchPolicy.h"
+
+class TestLaunchPolicy : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir configDir;
+
+    static void writeFile(const QString &path, const QByteArray &contents) {
+        QDir().mkpath(QFileInfo(path).path());
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(contents);
+    }
+
+private slots:
+    void initTestCase() {
+        QVERIFY(configDir.isValid());
+        qputenv("XDG_CONFIG_HOME", configDir.path().toUtf8());
+    }
+
+    void testUserOverridesBundle() {
+        QTemporaryDir applications;
+        const QString bundle = applications.filePath("Syncthing.app");
+        writeFile(bundle + "/Resources/launch-policy.conf",
+                  "Nice=5\nIOSchedulingClass=idle\nCPUAffinity=0-1,3\nLimitNOFILE=1024:4096\n");
+        writeFile(configDir.filePath("launch/policies.conf"),
+                  "[Syncthing]\nNice=10\nCPUSchedulingPolicy=batch\nLimitNOFILE=infinity\n"
+                  "[FeatherPad]\nNice=-5\n");
+
+        LaunchPolicy policy = LaunchPolicy::forApplication(bundle);
+        QVERIFY(policy.hasNice);
+        QCOMPARE(policy.nice, 10);
+        QCOMPARE(policy.ioClass, LaunchPolicy::IdleIOClass);
+        QCOMPARE(policy.scheduler, LaunchPolicy::BatchScheduler);
+        QCOMPARE(policy.cpus, std::vector<int>({ 0, 1, 3 }));
+        QCOMPARE(policy.limits.size(), size_t(1));
+        QCOMPARE(policy.limits[0].soft, RLIM_INFINITY);
+        QCOMPARE(policy.toString(),
+                 QString("Nice=10 IOSchedulingClass=idle CPUSchedulingPolicy=batch "
+                         "CPUAffinity=0,1,3 LimitNOFILE=infinity:infinity"));
+
+        QVERIFY(LaunchPolicy::forApplication(applications.filePath("Kate.AppDir")).isEmpty());
+        QCOMPARE(LaunchPolicy::forApplication("/usr/local/bin/FeatherPad").nice, -5);
+    }
+
+    void testInvalidValuesAreIgnored() {
+        QTemporaryDir bundle;
+        writeFile(bundle.filePath("Resources/launch-policy.conf"),
+                  "Nice=100\nIOSchedulingClass=fast\nCPUAffinity=3-1\nLimitNOFILE=2:1\n");
+        QVERIFY(LaunchPolicy::forApplication(bundle.path()).isEmpty());
+    }
+
+    void testApply() {
+        QProcess process;
+        process.start("sleep", { "10" });
+        QVERIFY(process.waitForStarted());
+        const pid_t pid = pid_t(process.processId());
+
+        LaunchPolicy policy;
+        policy.hasNice = true;
+        policy.nice = 19;
+        policy.limits.push_back({ RLIMIT_CORE, 0, 0 });
+        QVERIFY(policy.apply(pid));
+        QCOMPARE(getpriority(PRIO_PROCESS, id_t(pid)), 19);
+#if defined(__linux__)
+        struct rlimit limit;
+        QCOMPARE(prlimit(pid, RLIMIT_CORE, nullptr, &limit), 0);
+        QCOMPARE(limit.rlim_cur, rlim_t(0));
+#endif
+        process.kill();
+        process.waitForFinished();
+    }
+};
+
+QTEST_APPLESS_MAIN(TestLaunchPolicy)
+
+#include "testLaunchPolicy.moc"
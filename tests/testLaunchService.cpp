@@ -0,0 +1,180 @@
+#include <QCoreApplication>
+#include <QtDBus>
+#include <QtTest>
+
+#include "LaunchService.h"
+#include "launcher.h"
+
+// Runs LaunchService on a private dbus-daemon instance so that the test
+// neither needs nor disturbs a session bus
+class TestLaunchService : public QObject {
+    Q_OBJECT
+
+private:
+    QProcess bus;
+    QString address;
+    QTemporaryDir dir;
+
+    QDBusMessage resolve(const QString &path) {
+        QDBusConnection client = QDBusConnection::connectToBus(address, "client");
+        QDBusMessage message =
+                QDBusMessage::createMethodCall("local.Launch", "/", "local.Launch", "Resolve");
+        message << path;
+        // The service lives in this thread, so keep processing events while waiting
+        return client.call(message, QDBus::BlockWithGui, 10 * 1000);
+    }
+
+private slots:
+    void initTestCase() {
+        if (QStandardPaths::findExecutable("dbus-daemon").isEmpty())
+            QSKIP("dbus-daemon is not installed");
+
+        bus.start("dbus-daemon", { "--session", "--nofork", "--print-address" });
+        QVERIFY(bus.waitForStarted());
+        QVERIFY(bus.waitForReadyRead(5000));
+        address = QString::fromUtf8(bus.readLine()).trimmed();
+        QVERIFY(!address.isEmpty());
+
+        QDBusConnection connection = QDBusConnection::connectToBus(address, "service");
+        QVERIFY(connection.isConnected());
+        LaunchService *service = new LaunchService(this);
+        QVERIFY(connection.registerObject("/", service, QDBusConnection::ExportAllSlots));
+        QVERIFY(connection.registerService("local.Launch"));
+    }
+
+    void cleanupTestCase() {
+        QDBusConnection::disconnectFromBus("client");
+        QDBusConnection::disconnectFromBus("service");
+        bus.kill();
+        bus.waitForFinished();
+    }
+
+    void testResolveExecutable() {
+        QDBusMessage reply = resolve("/usr/bin/env");
+        QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+        QCOMPARE(reply.arguments().first().toString(), QString("/usr/bin/env"));
+    }
+
+    void testResolveDesktopFile() {
+        QString path = dir.path() + "/test.desktop";
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write("[Desktop Entry]\nType=Application\nName=Test\nExec=true\n");
+        file.close();
+
+        QDBusMessage reply = resolve(path);
+        QCOMPARE(reply.type(), QDBusMessage::ReplyMessage);
+        QCOMPARE(reply.arguments().first().toString(), path);
+    }
+
+    void testResolveMissingFile() {
+        QDBusMessage reply = resolve(dir.path() + "/does-not-exist");
+        QCOMPARE(reply.type(), QDBusMessage::ErrorMessage);
+        QVERIFY(reply.errorMessage().contains("can't be found"));
+    }
+
+    void testDocumentsAreGroupedByApplication() {
+        QStringList documents;
+        for (const QString &name : { "a.txt", "b.txt" }) {
+            QFile file(dir.path() + "/" + name);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write("Some text\n");
+            documents.append(file.fileName());
+        }
+        QString editor = dir.path() + "/editor.desktop";
+        QString viewer = dir.path() + "/viewer.desktop";
+        for (const QString &path : { editor, viewer }) {
+            QFile file(path);
+            QVERIFY(file.open(QIODevice::WriteOnly));
+            file.write(path == editor ? "[Desktop Entry]\nType=Application\nExec=true %F\n"
+                                      : "[Desktop Entry]\nType=Application\nExec=true --file=%f\n");
+        }
+        const QString mimePath = DbManager::localShareLaunchMimePath + "text_plain";
+        QVERIFY(QDir().mkpath(mimePath));
+        QFile::remove(mimePath + "/Default");
+        QVERIFY(QFile::link(editor, mimePath + "/Default"));
+
+        Launcher launcher;
+        launcher.setInteractive(false);
+        QStringList errors;
+        QList<QStringList> requests = launcher.launchRequestsForDocuments(
+                documents + QStringList({ "/usr/bin/env", dir.path() + "/does-not-exist" }),
+                false, &errors);
+        QCOMPARE(requests.size(), 2);
+        QCOMPARE(requests[0], QStringList({ editor }) + documents);
+        QCOMPARE(requests[1], QStringList({ "/usr/bin/env" }));
+        QCOMPARE(errors.size(), 1);
+
+        // Applications that take one file at a time get one instance per document
+        QFile::remove(mimePath + "/Default");
+        QVERIFY(QFile::link(viewer, mimePath + "/Default"));
+        requests = launcher.launchRequestsForDocuments(documents);
+        QCOMPARE(requests.size(), 2);
+        QCOMPARE(requests[0], QStringList({ viewer, documents[0] }));
+        QCOMPARE(requests[1], QStringList({ viewer, documents[1] }));
+        QCOMPARE(launcher.plan(requests[0]).arguments, QStringList({ "--file=" + documents[0] }));
+        QFile::remove(mimePath + "/Default");
+
+        // An executable as the first argument gets the others as its arguments
+        requests = launcher.launchRequestsForDocuments({ "/usr/bin/env", documents[0] });
+        QCOMPARE(requests.size(), 1);
+        QCOMPARE(requests[0], QStringList({ "/usr/bin/env", documents[0] }));
+    }
+
+    void testBatch() {
+        FILE *input = tmpfile();
+        FILE *output = tmpfile();
+        QVERIFY(input && output);
+        const QByteArray requests = "/usr/bin/env true\n\n'" + dir.path().toUtf8()
+                + "/does not exist'\n";
+        fwrite(requests.constData(), 1, size_t(requests.size()), input);
+        rewind(input);
+
+        Launcher launcher;
+        QCOMPARE(launcher.batch(input, output, false, false), 1);
+        rewind(output);
+        QFile results;
+        QVERIFY(results.open(output, QIODevice::ReadOnly));
+        QList<QByteArray> lines = results.readAll().split('\n');
+        QCOMPARE(lines.size(), 3);
+        QVERIFY(lines[2].isEmpty());
+
+        QJsonObject ok = QJsonDocument::fromJson(lines[0]).object();
+        QCOMPARE(ok.value("status").toString(), QString("ok"));
+        QCOMPARE(ok.value("request").toArray().size(), 2);
+        QCOMPARE(ok.value("pids").toArray().size(), 1);
+        QCOMPARE(ok.value("executables").toArray().first().toString(), QString("/usr/bin/env"));
+
+        QJsonObject failed = QJsonDocument::fromJson(lines[1]).object();
+        QCOMPARE(failed.value("status").toString(), QString("error"));
+        QCOMPARE(failed.value("request").toArray().first().toString(),
+                 dir.path() + "/does not exist");
+        QVERIFY(failed.value("error").toString().contains("can't be found"));
+        results.close();
+        fclose(input);
+        fclose(output);
+    }
+
+    void testBatchNullSeparated() {
+        FILE *input = tmpfile();
+        FILE *output = tmpfile();
+        QVERIFY(input && output);
+        static const char requests[] = "/usr/bin/env\0true\0\0/usr/bin/env\0true\0";
+        fwrite(requests, 1, sizeof(requests) - 1, input);
+        rewind(input);
+
+        Launcher launcher;
+        QCOMPARE(launcher.batch(input, output, false, true), 0);
+        rewind(output);
+        QFile results;
+        QVERIFY(results.open(output, QIODevice::ReadOnly));
+        QCOMPARE(results.readAll().count('\n'), 2);
+        results.close();
+        fclose(input);
+        fclose(output);
+    }
+ };
+
+QTEST_GUILESS_MAIN(TestLaunchService)
+
+#include "testLaunchService.moc"
@@ -0,0 +1,83 @@
+#include <QCoreApplication>
+#include <QtDBus>
+#include <QtTest>
+
+#include "MenuNotifier.h"
+
+// Stands in for Menu and records what it has been told
+class StubMenu : public QObject {
+    Q_OBJECT
+    Q_CLASSINFO("D-Bus Interface", "local.Menu")
+
+public:
+    QStringList calls;
+
+public slots:
+    QString showApplicationName(const QString &name) {
+        calls.append("show " + name);
+        return name;
+    }
+    QString hideApplicationName() {
+        calls.append("hide");
+        return QString();
+    }
+};
+
+// Runs the stub Menu on a private dbus-daemon instance, which MenuNotifier
+// uses as its session bus
+class TestMenuNotifier : public QObject {
+    Q_OBJECT
+
+private:
+    QProcess bus;
+    StubMenu menu;
+
+private slots:
+    void initTestCase() {
+        if (QStandardPaths::findExecutable("dbus-daemon").isEmpty())
+            QSKIP("dbus-daemon is not installed");
+
+        bus.start("dbus-daemon", { "--session", "--nofork", "--print-address" });
+        QVERIFY(bus.waitForStarted());
+        QVERIFY(bus.waitForReadyRead(5000));
+        QByteArray address = bus.readLine().trimmed();
+        QVERIFY(!address.isEmpty());
+        qputenv("DBUS_SESSION_BUS_ADDRESS", address);
+
+        QDBusConnection connection = QDBusConnection::connectToBus(QString::fromUtf8(address), "menu");
+        QVERIFY(connection.isConnected());
+        QVERIFY(connection.registerObject("/", &menu, QDBusConnection::ExportAllSlots));
+        QVERIFY(connection.registerService("local.Menu"));
+    }
+
+    void cleanupTestCase() {
+        QDBusConnection::disconnectFromBus("menu");
+        bus.kill();
+        bus.waitForFinished();
+    }
+
+    void testDoesNotWaitForMenu() {
+        // The stub lives in this thread, so it can't answer before we return to
+        // the event loop; a synchronous call would block until its timeout
+        QElapsedTimer clock;
+        clock.start();
+        MenuNotifier::showApplicationName("FeatherPad");
+        MenuNotifier::hideApplicationName();
+        QVERIFY(clock.elapsed() < MenuNotifier::TimeoutMsecs);
+
+        QTRY_COMPARE(menu.calls, QStringList({ "show FeatherPad", "hide" }));
+    }
+
+    void testFlushIsBounded() {
+        // Menu is stuck (no events are processed here), so flush() has to give up
+        QElapsedTimer clock;
+        clock.start();
+        MenuNotifier::showApplicationName("Kate");
+        MenuNotifier::flush();
+        QVERIFY(clock.elapsed() < 5 * MenuNotifier::TimeoutMsecs);
+    }
+};
+
+QTEST_GUILESS_MAIN(TestMenuNotifier)
+
+#include "testMenuNotifier.moc"
@@ -0,0 +1,81 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "PackageIndex.h"
+
+class TestPackageIndex : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testLookup() {
+        if (!PackageIndex::refresh())
+            QSKIP("No supported package manager");
+
+        // Look up every 1000th path of the index, and make sure that each is found
+        QFile index(PackageIndex::indexPath());
+        QVERIFY(index.open(QIODevice::ReadOnly));
+        QVERIFY(index.readLine().startsWith("launch-package-index"));
+        int checked = 0;
+        for (int i = 0; !index.atEnd(); i++) {
+            QByteArray line = index.readLine().trimmed();
+            if (i % 1000 != 0)
+                continue;
+            QList<QByteArray> fields = line.split('\t');
+            QCOMPARE(fields.size(), 2);
+            QCOMPARE(PackageIndex::packageForFile(QString::fromUtf8(fields[0])),
+                     QString::fromUtf8(fields[1]));
+            QVERIFY(PackageIndex::updateCommand(QString::fromUtf8(fields[0]))
+                            .contains(QString::fromUtf8(fields[1])));
+            checked++;
+        }
+        QVERIFY(checked > 0);
+
+        QVERIFY(PackageIndex::packageForFile("/nonexistent/file").isEmpty());
+    }
+
+    void testUpToDateIndexIsKept() {
+        if (!PackageIndex::refresh())
+            QSKIP("No supported package manager");
+        QDateTime modified = QFileInfo(PackageIndex::indexPath()).lastModified();
+        QVERIFY(PackageIndex::refresh());
+        QCOMPARE(QFileInfo(PackageIndex::indexPath()).lastModified(), modified);
+    }
+
+    void testOutdatedIndexIsUsed() {
+        if (!PackageIndex::refresh())
+            QSKIP("No supported package manager");
+        QFile index(PackageIndex::indexPath());
+        QVERIFY(index.open(QIODevice::ReadOnly));
+        const QByteArray header = index.readLine();
+        const QByteArray entry = index.readLine().trimmed();
+        const QByteArray rest = index.readAll();
+        index.close();
+
+        // As if the package database had changed since the index was built
+        QList<QByteArray> fields = header.trimmed().split('\t');
+        QVERIFY(fields.size() > 3);
+        fields[3] = "0";
+        QVERIFY(index.open(QIODevice::WriteOnly | QIODevice::Truncate));
+        index.write(fields.join('\t') + '\n' + entry + '\n' + rest);
+        index.close();
+
+        const QList<QByteArray> entryFields = entry.split('\t');
+        QCOMPARE(PackageIndex::packageForFile(QString::fromUtf8(entryFields[0])),
+                 QString::fromUtf8(entryFields[1]));
+
+        // Rebuilt in the background
+        for (int i = 0; i < 600; i++) {
+            QVERIFY(index.open(QIODevice::ReadOnly));
+            const bool rebuilt = index.readLine() == header;
+            index.close();
+            if (rebuilt)
+                return;
+            QThread::msleep(100);
+        }
+        QFAIL("The index was not rebuilt");
+    }
+};
+
+QTEST_APPLESS_MAIN(TestPackageIndex)
+
+#include "testPackageIndex.moc"
@@ -0,0 +1,73 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "PlanCache.h"
+
+class TestPlanCache : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir runtimeDir;
+
+private slots:
+    void initTestCase() {
+        QVERIFY(runtimeDir.isValid());
+        QFile::setPermissions(runtimeDir.path(), QFileDevice::ReadOwner | QFileDevice::WriteOwner
+                                                         | QFileDevice::ExeOwner);
+        qputenv("XDG_RUNTIME_DIR", runtimeDir.path().toUtf8());
+    }
+
+    void testPlan() {
+        QTemporaryDir applications;
+        const QString executable = applications.filePath("Tool");
+        QFile file(executable);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.close();
+
+        LaunchPlan plan;
+        plan.executable = executable;
+        plan.arguments = QStringList({ "--new-window", "README" });
+        PlanCache::storePlan({ "Tool", "README" }, plan);
+
+        LaunchPlan found;
+        QVERIFY(!PlanCache::findPlan({ "Tool" }, &found));
+        QVERIFY(PlanCache::findPlan({ "Tool", "README" }, &found));
+        QCOMPARE(found.executable, executable);
+        QCOMPARE(found.arguments, plan.arguments);
+        QVERIFY(found.bundle.isEmpty());
+
+        // An updated application is resolved again
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(10),
+                                 QFileDevice::FileModificationTime));
+        file.close();
+        QVERIFY(!PlanCache::findPlan({ "Tool", "README" }, &found));
+    }
+
+    void testApplication() {
+        PlanCache::storeApplication("README", "/usr/local/bin/featherpad", "/home/user/README");
+        QString application, document;
+        QVERIFY(!PlanCache::findApplication("LICENSE", &application, &document));
+        QVERIFY(PlanCache::findApplication("README", &application, &document));
+        QCOMPARE(application, QString("/usr/local/bin/featherpad"));
+        QCOMPARE(document, QString("/home/user/README"));
+
+        // An updated .desktop file is resolved again
+        QTemporaryDir applications;
+        const QString desktopFile = applications.filePath("featherpad.desktop");
+        QFile file(desktopFile);
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.close();
+        PlanCache::storeApplication("NEWS", desktopFile, "/home/user/NEWS");
+        QVERIFY(PlanCache::findApplication("NEWS", &application, &document));
+        QVERIFY(file.open(QIODevice::ReadWrite));
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(10),
+                                 QFileDevice::FileModificationTime));
+        file.close();
+        QVERIFY(!PlanCache::findApplication("NEWS", &application, &document));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestPlanCache)
+
+#include "testPlanCache.moc"
@@ -0,0 +1,46 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include <unistd.h>
+
+#include "Platform.h"
+
+class TestPlatform : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testMakeExecutable() {
+        QTemporaryFile file;
+        QVERIFY(file.open());
+        QVERIFY(file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner
+                                    | QFileDevice::ReadGroup));
+        QVERIFY(Platform::makeExecutable(file.fileName()));
+        QCOMPARE(QFileInfo(file.fileName()).permissions()
+                         & (QFileDevice::ExeOwner | QFileDevice::ExeGroup | QFileDevice::ExeOther),
+                 QFileDevice::ExeOwner | QFileDevice::ExeGroup);
+        QVERIFY(!Platform::makeExecutable("/nonexistent/file"));
+    }
+
+    void testTouch() {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QDateTime past = QDateTime::currentDateTime().addDays(-1);
+        QFile file(dir.path());
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        QVERIFY(file.setFileTime(past, QFileDevice::FileModificationTime));
+        file.close();
+        QVERIFY(Platform::touch(dir.path()));
+        QVERIFY(QFileInfo(dir.path()).lastModified() > past.addSecs(60));
+    }
+
+    void testProcess() {
+        QCOMPARE(Platform::processOwner(getpid()), geteuid());
+        QCOMPARE(Platform::processOwner(-1), uid_t(-1));
+        QCOMPARE(QFileInfo(Platform::processExecutable(getpid())).canonicalFilePath(),
+                 QFileInfo(QCoreApplication::applicationFilePath()).canonicalFilePath());
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPlatform)
+
+#include "testPlatform.moc"
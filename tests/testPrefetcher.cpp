@@ -0,0 +1,52 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include <unistd.h>
+
+#include "Prefetcher.h"
+
+class TestPrefetcher : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testRecordAndPrefetch() {
+        const QString key = "/Applications/TestPrefetcher.app";
+        QFile::remove(Prefetcher::historyPath(key));
+
+        // Our own executable is mapped and, since it is running, in the page cache
+        Prefetcher::record(key, getpid());
+        QFile history(Prefetcher::historyPath(key));
+        QVERIFY(history.open(QIODevice::ReadOnly));
+        QVERIFY(history.readLine().startsWith("launch-prefetch"));
+        const QString self = QFileInfo(QCoreApplication::applicationFilePath()).canonicalFilePath();
+        bool found = false;
+        while (!history.atEnd()) {
+            QList<QByteArray> fields = history.readLine().trimmed().split('\t');
+            QCOMPARE(fields.size(), 4);
+            QVERIFY(fields[3].contains('+'));
+            QVERIFY(!fields[0].endsWith("/locale-archive"));
+            qint64 recorded = 0;
+            for (const QByteArray &range : fields[3].split(','))
+                recorded += range.mid(range.indexOf('+') + 1).toLongLong();
+            QVERIFY(recorded <= 32 * 1024 * 1024);
+            if (QFileInfo(QString::fromUtf8(fields[0])).canonicalFilePath() == self)
+                found = true;
+        }
+        QVERIFY(found);
+
+        Prefetcher::prefetchNow(key);
+        Prefetcher::prefetchNow("/Applications/NeverLaunched.app");
+    }
+
+    void testDisabled() {
+        const QString key = "/Applications/Disabled.app";
+        qputenv("LAUNCH_PREFETCH", "0");
+        Prefetcher::record(key, getpid());
+        qunsetenv("LAUNCH_PREFETCH");
+        QVERIFY(!QFile::exists(Prefetcher::historyPath(key)));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestPrefetcher)
+
+#include "testPrefetcher.moc"
@@ -0,0 +1,80 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include <unistd.h>
+
+#include "RunningRegistry.h"
+
+class TestRunningRegistry : public QObject {
+    Q_OBJECT
+
+private:
+    QTemporaryDir runtimeDir;
+
+private slots:
+    void initTestCase() {
+        QVERIFY(runtimeDir.isValid());
+        QFile::setPermissions(runtimeDir.path(), QFileDevice::ReadOwner | QFileDevice::WriteOwner
+                                                         | QFileDevice::ExeOwner);
+        qputenv("XDG_RUNTIME_DIR", runtimeDir.path().toUtf8());
+    }
+
+    void testLookup() {
+        RunningRegistry::add("/Applications/FeatherPad.app", getpid());
+        QList<RunningRegistry::Instance> instances =
+                RunningRegistry::instances("/Applications/FeatherPad.app");
+        QCOMPARE(instances.size(), 1);
+        QCOMPARE(instances.first().pid, qint64(getpid()));
+        QCOMPARE(instances.first().uid, geteuid());
+        QVERIFY(RunningRegistry::instances("/Applications/Kate.AppDir").isEmpty());
+
+        RunningRegistry::remove(getpid());
+        QVERIFY(RunningRegistry::instances("/Applications/FeatherPad.app").isEmpty());
+    }
+
+    void testExitedProcessIsReaped() {
+        QProcess process;
+        process.start("sleep", { "10" });
+        QVERIFY(process.waitForStarted());
+        RunningRegistry::add("/Applications/Kate.AppDir", process.processId());
+        QCOMPARE(RunningRegistry::instances("/Applications/Kate.AppDir").size(), 1);
+
+        process.kill();
+        process.waitForFinished();
+        QVERIFY(RunningRegistry::instances("/Applications/Kate.AppDir").isEmpty());
+        QVERIFY(!QFile::exists(RunningRegistry::directory() + "/"
+                               + QString::number(process.processId())));
+    }
+
+    void testReusedPidIsReaped() {
+        // An entry for our PID, but with a start time of another process
+        QDir().mkpath(RunningRegistry::directory());
+        QFile entry(RunningRegistry::directory() + "/" + QString::number(getpid()));
+        QVERIFY(entry.open(QIODevice::WriteOnly));
+        entry.write("/Applications/FeatherPad.app\n1\n" + QByteArray::number(geteuid()) + "\n");
+        entry.close();
+        QVERIFY(RunningRegistry::instances("/Applications/FeatherPad.app").isEmpty());
+        QVERIFY(!entry.exists());
+    }
+
+    void testStartLock() {
+        RunningRegistry::StartLock first;
+        QVERIFY(first.acquire("/Applications/FeatherPad.app", 1000));
+
+        // flock() locks belong to the open file, so a second one conflicts even
+        // within the same process
+        RunningRegistry::StartLock second;
+        QElapsedTimer clock;
+        clock.start();
+        QVERIFY(!second.acquire("/Applications/FeatherPad.app", 100));
+        QVERIFY(clock.elapsed() >= 100);
+        QVERIFY(second.acquire("/Applications/Kate.AppDir", 100));
+
+        first.release();
+        QVERIFY(second.acquire("/Applications/FeatherPad.app", 100));
+    }
+};
+
+QTEST_GUILESS_MAIN(TestRunningRegistry)
+
+#include "testRunningRegistry.moc"
@@ -0,0 +1,143 @@
+#include <QCoreApplication>
+#include <QtTest>
+
+#include "Spawner.h"
+
+#include <errno.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+class TestSpawner : public QObject {
+    Q_OBJECT
+
+private slots:
+    void testExitCode() {
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "exit 3" });
+        QVERIFY(p.start());
+        QVERIFY(p.waitForFinished(5000));
+        QVERIFY(!p.isRunning());
+        QCOMPARE(p.exitCode(), 3);
+    }
+
+    void testExecFailureIsReportedSynchronously() {
+        Spawner p;
+        p.setProgram("/nonexistent/program");
+        QVERIFY(!p.start());
+        QVERIFY(!p.isRunning());
+        QVERIFY(!p.errorString().isEmpty());
+    }
+
+    void testStartDetached() {
+        int fds[2];
+        QVERIFY(pipe(fds) == 0);
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "echo $$" });
+        p.setStandardInputOutputFds(-1, fds[1]);
+        QVERIFY(p.startDetached());
+        close(fds[1]);
+        QVERIFY(!p.isRunning());
+        // Not our child, so there is nothing to reap
+        QCOMPARE(waitpid(p.pid(), nullptr, WNOHANG), pid_t(-1));
+        QCOMPARE(errno, ECHILD);
+        char output[32] = {};
+        QVERIFY(read(fds[0], output, sizeof(output) - 1) > 0);
+        close(fds[0]);
+        QCOMPARE(QByteArray(output).trimmed().toInt(), int(p.pid()));
+
+        Spawner missing;
+        missing.setProgram("/nonexistent/program");
+        QVERIFY(!missing.startDetached());
+        QVERIFY(!missing.errorString().isEmpty());
+    }
+
+    void testCaptureStandardError() {
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "echo oops >&2" });
+        p.setCaptureStandardError(true);
+        QVERIFY(p.start());
+        QVERIFY(p.waitForFinished(5000));
+        QCOMPARE(p.readAllStandardError(), QByteArray("oops\n"));
+    }
+
+    void testEnvironment() {
+        QProcessEnvironment env;
+        env.insert("LAUNCHED_BUNDLE", "/Applications/Test.app");
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "test \"$LAUNCHED_BUNDLE\" = /Applications/Test.app" });
+        p.setProcessEnvironment(env);
+        QVERIFY(p.start());
+        QVERIFY(p.waitForFinished(5000));
+        QCOMPARE(p.exitCode(), 0);
+    }
+
+    void testTimeout() {
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "sleep 2" });
+        QVERIFY(p.start());
+        QVERIFY(!p.waitForFinished(100));
+        QVERIFY(p.isRunning());
+        QVERIFY(p.waitForFinished(5000));
+    }
+
+    void testStandardErrorIsBounded() {
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "echo first >&2; head -c 1000000 /dev/zero | tr '\\0' x >&2; echo last >&2" });
+        p.setCaptureStandardError(true);
+        QVERIFY(p.start());
+        QVERIFY(p.waitForFinished(5000));
+        QByteArray error = p.readAllStandardError();
+        QVERIFY(error.size() < 128 * 1024);
+        QVERIFY(error.startsWith("first\n"));
+        QVERIFY(error.contains("bytes omitted"));
+        QVERIFY(error.endsWith("xlast\n"));
+    }
+
+    void testFatalErrorEndsWaitEarly() {
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "echo harmless >&2; echo 'FATAL: kernel too old' >&2; sleep 5" });
+        p.setCaptureStandardError(true);
+        p.setFatalErrorMatcher([](const QByteArray &line) { return line.startsWith("FATAL:"); });
+        QVERIFY(p.start());
+        QElapsedTimer timer;
+        timer.start();
+        QVERIFY(!p.waitForFinished(4000));
+        QVERIFY(timer.elapsed() < 3000);
+        QVERIFY(p.isRunning());
+        QVERIFY(p.hasFatalError());
+        QVERIFY(p.readAllStandardError().contains("FATAL: kernel too old"));
+        kill(p.pid(), SIGTERM);
+        QVERIFY(p.waitForFinished(5000));
+    }
+
+    void testLogStandardError() {
+        QTemporaryDir stateHome;
+        QVERIFY(stateHome.isValid());
+        qputenv("XDG_STATE_HOME", QFile::encodeName(stateHome.path()));
+        Spawner p;
+        p.setProgram("/bin/sh");
+        p.setArguments({ "-c", "echo before >&2; sleep 0.2; echo after >&2" });
+        p.setCaptureStandardError(true);
+        QVERIFY(p.start());
+        QVERIFY(!p.waitForFinished(100));
+        QVERIFY(p.setLogStandardError("Test"));
+        p.setForwardStandardError(true, -1);
+        QVERIFY(p.waitForFinished(5000));
+        QFile log(QString("%1/launch/logs/Test-%2.log").arg(stateHome.path()).arg(p.pid()));
+        QVERIFY(log.open(QIODevice::ReadOnly));
+        QCOMPARE(log.readAll(), QByteArray("before\nafter\n"));
+        qunsetenv("XDG_STATE_HOME");
+    }
+};
+
+QTEST_APPLESS_MAIN(TestSpawner)
+
+#include "testSpawner.moc"